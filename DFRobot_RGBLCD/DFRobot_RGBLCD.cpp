@@ -31,26 +31,74 @@ DFRobot_RGBLCD::DFRobot_RGBLCD(uint8_t lcd_cols,uint8_t lcd_rows,PinName sda,Pin
 {
   _lcdAddr = lcd_Addr;
   _RGBAddr = RGB_Addr;
-  _cols = lcd_cols;
-  _rows = lcd_rows;
+  _cols = lcd_cols < LCD_MAX_COLS ? lcd_cols : LCD_MAX_COLS;
+  _rows = lcd_rows < LCD_MAX_ROWS ? lcd_rows : LCD_MAX_ROWS;
+  memset(_frame, ' ', sizeof(_frame));
+  memset(_shown, ' ', sizeof(_shown));
+  _frameCol = 0;
+  _frameRow = 0;
+  _lcdCol = LCD_ADDRESS_UNKNOWN;
+  _lcdRow = LCD_ADDRESS_UNKNOWN;
+  _tickerRow = LCD_NO_TICKER;
+  _tickerText = NULL;
+  _tickerLen = 0;
+  _tickerPos = 0;
+  _tickerLoaded = 0;
+  _readyAt = 0;
+  _conservative = false;
 }
 
 void DFRobot_RGBLCD::init()
 {
+	_timer.start();
 	_showfunction = LCD_4BITMODE | LCD_1LINE | LCD_5x8DOTS;
 	begin(_cols, _rows);
 }
 
 void DFRobot_RGBLCD::clear()
 {
-    command(LCD_CLEARDISPLAY);        // clear display, set cursor position to zero
-    ThisThread::sleep_for(2ms);          // this command takes a long time!
+    memset(_frame, ' ', sizeof(_frame));
+    _frameCol = 0;
+    _frameRow = 0;
 }
 
 void DFRobot_RGBLCD::home()
 {
-    command(LCD_RETURNHOME);        // set cursor position to zero
-    ThisThread::sleep_for(2ms);        // this command takes a long time!
+    _frameCol = 0;
+    _frameRow = 0;
+}
+
+void DFRobot_RGBLCD::flush()
+{
+    ///< the framebuffer maps to DDRAM only while the display isn't shifted
+    tickerStop();
+
+    ///< rows with changes, and rows with something on them
+    int changed = 0;
+    int used = 0;
+    for (uint8_t row = 0; row < _rows; row++) {
+        bool rowChanged = false;
+        bool rowUsed = false;
+        for (uint8_t col = 0; col < _cols; col++) {
+            rowChanged |= _frame[row][col] != _shown[row][col];
+            rowUsed |= _frame[row][col] != ' ';
+        }
+        changed += rowChanged;
+        used += rowUsed;
+    }
+    if (changed == 0) {
+        return;
+    }
+
+    ///< each row with changes costs a cursor move and a run. Clearing costs one transfer
+    ///< and saves the rows that become blank
+    if (1 + 2 * used < 2 * changed) {
+        clearDisplay();
+    }
+
+    for (uint8_t row = 0; row < _rows; row++) {
+        flushRow(row);
+    }
 }
 
 void DFRobot_RGBLCD::noDisplay()
@@ -96,6 +144,76 @@ void DFRobot_RGBLCD::scrollDisplayRight(void)
     command(LCD_CURSORSHIFT | LCD_DISPLAYMOVE | LCD_MOVERIGHT);
 }
 
+bool DFRobot_RGBLCD::tickerStart(uint8_t row, const char *text, size_t len)
+{
+    if (_rows != 2 || row >= _rows || len == 0) {
+        return false;
+    }
+
+    ///< starts from a blank display that isn't shifted, so only text has to be written
+    _tickerRow = LCD_NO_TICKER;
+    clearDisplay();
+    for (uint8_t other = 0; other < _rows; other++) {
+        uint8_t used = _cols;
+        while (used > 0 && _frame[other][used - 1] == ' ') {
+            used--;
+        }
+        if (other != row && used > 0) {
+            moveTo(0, other);
+            writeRun((const char *)_frame[other], used);
+            memcpy(_shown[other], _frame[other], used);
+        }
+    }
+
+    _tickerRow = row;
+    _tickerText = text;
+    _tickerLen = len;
+    _tickerPos = 0;
+    _tickerLoaded = 0;
+    tickerFill();
+    return true;
+}
+
+void DFRobot_RGBLCD::tickerStep()
+{
+    if (!tickerRunning()) {
+        return;
+    }
+
+    ///< the column that the shift brings into view has to be loaded first
+    if (_tickerLoaded <= _tickerPos + _cols) {
+        tickerFill();
+    }
+    scrollDisplayLeft();
+    _tickerPos++;
+}
+
+void DFRobot_RGBLCD::tickerRedraw()
+{
+    if (!tickerRunning()) {
+        return;
+    }
+
+    ///< a row keeps its DDRAM columns while the display is shifted, so it is updated
+    ///< wherever it has scrolled to
+    for (uint8_t row = 0; row < _rows; row++) {
+        if (row != _tickerRow) {
+            flushRow(row);
+        }
+    }
+}
+
+void DFRobot_RGBLCD::tickerStop()
+{
+    if (!tickerRunning()) {
+        return;
+    }
+
+    _tickerRow = LCD_NO_TICKER;
+    _tickerText = NULL;
+    clearDisplay();
+}
+
 void DFRobot_RGBLCD::leftToRight(void)
 {
     _showmode |= LCD_ENTRYLEFT;
@@ -127,23 +245,13 @@ void DFRobot_RGBLCD::customSymbol(uint8_t location, uint8_t charmap[])
     command(LCD_SETCGRAMADDR | (location << 3));
     
     
-    uint8_t data[9];
-    data[0] = 0x40;
-    for(int i=0; i<8; i++)
-    {
-        data[i+1] = charmap[i];
-    }
-    send(data, 9);
+    writeRun((const char *)charmap, 8);
 }
 
 void DFRobot_RGBLCD::setCursor(uint8_t col, uint8_t row)
 {
-
-    col = (row == 0 ? col|0x80 : col|0xc0);
-    uint8_t data[3] = {0x80, col};
-
-    send(data, 2);
-
+    _frameCol = col;
+    _frameRow = row;
 }
 
 void DFRobot_RGBLCD::setRGB(uint8_t r, uint8_t g, uint8_t b)
@@ -173,18 +281,26 @@ void DFRobot_RGBLCD::noBlinkLED(void)
     setReg(0x06, 0xff);
 }
 
-inline size_t DFRobot_RGBLCD::write(uint8_t value)
+size_t DFRobot_RGBLCD::write(uint8_t value)
 {
-
-    uint8_t data[3] = {0x40, value};
-    send(data, 2);
+    ///< text past the edge is dropped, like text written to DDRAM that isn't shown
+    if (_frameRow < _rows && _frameCol < _cols) {
+        _frame[_frameRow][_frameCol] = value;
+    }
+    if (_frameCol < 0xff) {
+        _frameCol++;
+    }
     return 1; // assume sucess
 }
 
-inline void DFRobot_RGBLCD::command(uint8_t value)
+void DFRobot_RGBLCD::command(uint8_t value)
 {
     uint8_t data[3] = {0x80, value};
     send(data, 2);
+
+    ///< the caller sets the address again if the command leaves it known
+    _lcdCol = LCD_ADDRESS_UNKNOWN;
+    _lcdRow = LCD_ADDRESS_UNKNOWN;
 }
 
 void DFRobot_RGBLCD::blink_on(){
@@ -279,6 +395,7 @@ void DFRobot_RGBLCD::begin(uint8_t cols, uint8_t lines, uint8_t dotsize)
     display();
 
     ///< clear it off
+    clearDisplay();
     clear();
 
     ///< Initialize to default text direction (for romance languages)
@@ -299,10 +416,131 @@ void DFRobot_RGBLCD::begin(uint8_t cols, uint8_t lines, uint8_t dotsize)
 
 }
 
+void DFRobot_RGBLCD::clearDisplay()
+{
+    command(LCD_CLEARDISPLAY);        // clear display, set cursor position to zero
+    memset(_shown, ' ', sizeof(_shown));
+    _lcdCol = 0;
+    _lcdRow = 0;
+}
+
+void DFRobot_RGBLCD::moveTo(uint8_t col, uint8_t row)
+{
+    ///< DDRAM address of the start of each row
+    static const uint8_t rowAddress[LCD_MAX_ROWS] = {0x00, 0x40, 0x14, 0x54};
+
+    command(LCD_SETDDRAMADDR | (rowAddress[row] + col));
+    _lcdCol = col;
+    _lcdRow = row;
+}
+
+///< writes the cells of the row that differ from what is shown. Unchanged cells
+///< between two changes are written along with them when that saves a cursor move
+void DFRobot_RGBLCD::flushRow(uint8_t row)
+{
+    uint8_t col = 0;
+    while (col < _cols) {
+        if (_frame[row][col] == _shown[row][col]) {
+            col++;
+            continue;
+        }
+
+        ///< the run ends where more than LCD_FLUSH_MERGE_GAP unchanged cells follow
+        uint8_t last = col;
+        for (uint8_t next = col + 1; next < _cols && next - last - 1 <= LCD_FLUSH_MERGE_GAP; next++) {
+            if (_frame[row][next] != _shown[row][next]) {
+                last = next;
+            }
+        }
+
+        if (_lcdRow != row || _lcdCol != col) {
+            moveTo(col, row);
+        }
+        writeRun((const char *)&_frame[row][col], last - col + 1);
+        memcpy(&_shown[row][col], &_frame[row][col], last - col + 1);
+        col = last + 1;
+        _lcdCol = col;
+    }
+}
+
+void DFRobot_RGBLCD::writeRun(const char *data, size_t len)
+{
+    ///< the controller takes a control byte of 0x40 followed by any number of data
+    ///< bytes, moving its address after each one, so a run is one transfer
+    uint8_t buffer[LCD_RUN_SIZE + 1];
+    buffer[0] = 0x40;
+
+    while (len > 0) {
+        uint8_t count = len < LCD_RUN_SIZE ? len : LCD_RUN_SIZE;
+        memcpy(buffer + 1, data, count);
+        send(buffer, count + 1);
+        data += count;
+        len -= count;
+    }
+}
+
+///< loads the text up to a full DDRAM line ahead of the leftmost column shown, over
+///< the columns that have scrolled off. Text position p goes in column p % 40
+void DFRobot_RGBLCD::tickerFill()
+{
+    char buffer[LCD_DDRAM_COLS];
+
+    while (_tickerLoaded < _tickerPos + LCD_DDRAM_COLS) {
+        ///< a run stops at the end of the line, where the address jumps to the next line
+        uint8_t col = _tickerLoaded % LCD_DDRAM_COLS;
+        uint32_t count = _tickerPos + LCD_DDRAM_COLS - _tickerLoaded;
+        if (count > (uint32_t)(LCD_DDRAM_COLS - col)) {
+            count = LCD_DDRAM_COLS - col;
+        }
+
+        for (uint32_t i = 0; i < count; i++) {
+            buffer[i] = _tickerText[(_tickerLoaded + i) % _tickerLen];
+        }
+        moveTo(col, _tickerRow);
+        writeRun(buffer, count);
+        _tickerLoaded += count;
+    }
+}
+
+///< blocks until the controller has carried out the last transfer. Waits of a
+///< millisecond or more sleep, shorter ones spin
+void DFRobot_RGBLCD::waitReady()
+{
+    while (true) {
+        int64_t remaining = _readyAt - _timer.elapsed_time().count();
+        if (remaining <= 0) {
+            return;
+        }
+        if (remaining >= 1000) {
+            ThisThread::sleep_for(std::chrono::milliseconds(remaining / 1000));
+        } else {
+            wait_us(remaining);
+        }
+    }
+}
+
+///< time the controller needs for a transfer. In a run of data only the last byte
+///< counts, since each byte takes longer on the bus than the one before takes to execute
+uint32_t DFRobot_RGBLCD::executionTime(const uint8_t *data, uint8_t len)
+{
+    if (_conservative) {
+        return LCD_CONSERVATIVE_US;
+    }
+    if (data[0] == 0x40) {
+        return LCD_DATA_US;
+    }
+
+    ///< clear (0x01) and return home (0x02 or 0x03) are the only slow instructions
+    uint8_t value = data[len - 1];
+    return value != 0 && value <= LCD_RETURNHOME + 1 ? LCD_SLOW_COMMAND_US : LCD_COMMAND_US;
+}
+
+///< only waits if the controller is still busy with the transfer before
 void DFRobot_RGBLCD::send(uint8_t *data, uint8_t len)
 {
+    waitReady();
     i2c.write(_lcdAddr, (char*)data, len);
-    ThisThread::sleep_for(5ms);
+    _readyAt = _timer.elapsed_time().count() + executionTime(data, len);
 }
 
 void DFRobot_RGBLCD::setReg(uint8_t addr, uint8_t data)
@@ -90,6 +90,55 @@
 #define LCD_5x10DOTS 0x04
 #define LCD_5x8DOTS 0x00
 
+/*!
+ *  @brief shadow framebuffer
+ *  @n The largest display the framebuffer holds. Bigger displays are cut to this size
+ */
+#define LCD_MAX_COLS 20
+#define LCD_MAX_ROWS 4
+
+/*!
+ *  @brief Unchanged cells a flush writes over to join two changed runs. Inside a
+ *  @n burst a cell costs one byte on the bus, far less than the transfer and wait
+ *  @n of a cursor move, so changes anywhere in a row are sent as one run
+ */
+#define LCD_FLUSH_MERGE_GAP LCD_MAX_COLS
+
+/*!
+ *  @brief Most data bytes sent in one transfer, the length of a DDRAM row
+ */
+#define LCD_RUN_SIZE 40
+
+/*!
+ *  @brief Marks the display address as unknown, after a command that may have moved it
+ */
+#define LCD_ADDRESS_UNKNOWN 0xff
+
+/*!
+ *  @brief Columns of DDRAM in each line of a two line display. The display shift moves
+ *  @n the window that is shown over them, and wraps around at the end
+ */
+#define LCD_DDRAM_COLS 40
+
+/*!
+ *  @brief Row of the ticker when there is none
+ */
+#define LCD_NO_TICKER 0xff
+
+/*!
+ *  @brief execution times in us (HD44780 datasheet, table 6). Clear and return home
+ *  @n take 1.52 ms, every other instruction 37 us, and a data write 37 us plus 4 us
+ *  @n for the address to move
+ */
+#define LCD_SLOW_COMMAND_US 1520
+#define LCD_COMMAND_US 37
+#define LCD_DATA_US 41
+
+/*!
+ *  @brief Wait after every transfer in conservative timing, for panels slower than the datasheet
+ */
+#define LCD_CONSERVATIVE_US 5000
+
 class DFRobot_RGBLCD
 {
 
@@ -105,8 +154,14 @@ public:
    */ 
   void init();
   
+  /*!
+   *  @brief Text goes to the shadow framebuffer. clear(), home(), setCursor(),
+   *  @n write() and printf() only change the framebuffer, and flush() sends
+   *  @n the cells that differ from what the display shows
+   */
   void clear();
   void home();
+  void flush();
 
   /*!
    *  @brief Turn the display on/off (quickly)
@@ -131,6 +186,32 @@ public:
    */
   void scrollDisplayLeft();
   void scrollDisplayRight();
+
+  /*!
+   *  @brief Runs text through a row by shifting the display. The 40 columns of DDRAM
+   *  @n hold what is shown and what comes next, so a tickerStep() is one shift command,
+   *  @n and the columns that have scrolled off are refilled in one run when the text
+   *  @n ahead runs out. The shift moves every row, so the other rows are loaded from the
+   *  @n framebuffer with spaces after them and wrap around along with the ticker.
+   *  @n The text repeats, and is read as the ticker moves, so it must stay unchanged
+   *  @n until the ticker stops. Only for two line displays
+   *  @return false if the display doesn't have two lines or the text is empty
+   */
+  bool tickerStart(uint8_t row, const char *text, size_t len);
+  void tickerStep();
+
+  /*!
+   *  @brief Sends the changes in the framebuffer to the rows other than the ticker's,
+   *  @n without stopping the ticker. The rows keep scrolling around with it
+   */
+  void tickerRedraw();
+
+  /*!
+   *  @brief Stops the ticker and clears the display, which also undoes the shift.
+   *  @n flush() stops the ticker first, and then redraws the whole framebuffer
+   */
+  void tickerStop();
+  bool tickerRunning() const {return _tickerRow != LCD_NO_TICKER;}
  
   /*!
    *  @brief This is for text that flows Left to Right
@@ -175,7 +256,7 @@ public:
   void noBlinkLED(void);
 
   /*!
-   *  @brief send data
+   *  @brief write a character to the framebuffer at the cursor
    */
   virtual size_t write(uint8_t);
 
@@ -183,6 +264,12 @@ public:
    *  @brief send command
    */
   void command(uint8_t);
+
+  /*!
+   *  @brief Waits a fixed 5 ms after every transfer instead of the execution time
+   *  @n of each command, for panels that are slower than the datasheet
+   */
+  void setConservativeTiming(bool conservative){_conservative = conservative;}
   
   /*!
    *  @brief compatibility API function aliases
@@ -215,6 +302,13 @@ private:
   void begin(uint8_t cols, uint8_t rows, uint8_t charsize = LCD_5x8DOTS);
   void send(uint8_t *data, uint8_t len);
   void setReg(uint8_t addr, uint8_t data);
+  void clearDisplay();
+  void moveTo(uint8_t col, uint8_t row);
+  void writeRun(const char *data, size_t len);
+  void flushRow(uint8_t row);
+  void tickerFill();
+  void waitReady();
+  uint32_t executionTime(const uint8_t *data, uint8_t len);
   uint8_t _showfunction;
   uint8_t _showcontrol;
   uint8_t _showmode;
@@ -226,6 +320,26 @@ private:
   uint8_t _rows;
   uint8_t _backlightval;
   I2C i2c;
+
+  ///< what the screens drew, and what the display shows
+  uint8_t _frame[LCD_MAX_ROWS][LCD_MAX_COLS];
+  uint8_t _shown[LCD_MAX_ROWS][LCD_MAX_COLS];
+  uint8_t _frameCol, _frameRow;
+
+  ///< position of the display's address counter
+  uint8_t _lcdCol, _lcdRow;
+
+  ///< row of the ticker and the text it cycles through. Positions in the text of the
+  ///< leftmost column shown, and of the first that isn't loaded into DDRAM yet
+  uint8_t _tickerRow;
+  const char *_tickerText;
+  size_t _tickerLen;
+  uint32_t _tickerPos, _tickerLoaded;
+
+  ///< time on _timer when the controller has carried out the last transfer
+  Timer _timer;
+  int64_t _readyAt;
+  bool _conservative;
 };
 
 #endif
@@ -0,0 +1,14 @@
+/**
+ * @file   ISM43362Interface.h
+ * @author Tobias Kallevik
+*/
+
+// Stand-in for the Wi-Fi driver. The host build uses the NetworkInterface from mbed.h directly
+
+#ifndef SMARTWATCH_HOST_ISM43362_INTERFACE_H
+#define SMARTWATCH_HOST_ISM43362_INTERFACE_H
+
+// Includes
+#include "mbed.h"
+
+#endif // SMARTWATCH_HOST_ISM43362_INTERFACE_H
@@ -0,0 +1,152 @@
+/**
+ * @file   fixtureServer.h
+ * @author Tobias Kallevik
+*/
+
+#ifndef SMARTWATCH_FIXTURE_SERVER_H
+#define SMARTWATCH_FIXTURE_SERVER_H
+
+// Includes
+#include "mbed.h"
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std::chrono;
+
+// Size of the pieces a chunked fixture body is sent in. Independent of how the bytes are split into receives
+#define FIXTURE_HTTP_CHUNK_SIZE 1000
+
+// Longest request header block the server reads, and longest header value it looks at
+#define FIXTURE_REQUEST_SIZE 1024
+#define FIXTURE_VALUE_SIZE 128
+
+// Size of the packets the NTP responder takes and sends
+#define FIXTURE_NTP_PACKET_SIZE 48
+
+// Unix time in us of the NTP responder's clock when the kernel clock reads 0. It runs with the kernel clock
+// from there, so the time the client computes can be checked against it
+#define FIXTURE_NTP_BASE_US 1700000000000000LL
+
+// Time in ms the NTP responder holds a request, which the client has to leave out of the network delay
+#define FIXTURE_NTP_HOLD_MS 3
+
+// How the link behaves. Faults are drawn from a seeded generator, so a run can be repeated exactly
+struct FixtureSettings {
+    // Most bytes a receive returns, like the 1460 byte payload of a full TCP segment
+    size_t chunkSize = 1460;
+
+    // Round trip time in ms, added to the kernel clock for each lookup, connect, handshake and response
+    int latencyMs = 0;
+
+    // Chance of a fault on each lookup, connect and response, from 0 to 1
+    double faultRate = 0;
+
+    uint32_t seed = 1;
+};
+
+// What the server has seen since the counters were reset
+struct FixtureCounters {
+    uint32_t lookups = 0;
+    uint32_t connects = 0;
+    uint32_t handshakes = 0;
+    uint32_t requests = 0;
+    uint32_t notModified = 0;
+    uint32_t faults = 0;
+    uint64_t bytesReceived = 0;
+    uint64_t bytesSent = 0;
+};
+
+// A fault injected into one response
+enum FixtureFault {
+    FaultNone,
+    // The connection is reset part way through the response
+    FaultReset,
+    // The server stops sending part way through, so the socket times out
+    FaultStall
+};
+
+// Recorded response for one host. Fixtures are read from <host>.http, or <host>.gz.http for the gzip
+// encoded variant, and hold the status line and headers, an empty line and the body as it is sent.
+// Content-Length or the chunk framing is added when the fixture is read, so serving it allocates nothing
+// that would show up in the heap use of the fetchers
+struct Fixture {
+    string host;
+    bool gzip;
+    string etag;
+    bool close;
+
+    // The full response, and the 304 sent when the request has the fixture's ETag
+    string response;
+    string notModified;
+};
+
+// Answers the requests of the host build from recorded responses, in place of the network
+class FixtureServer {
+public:
+    static FixtureServer &instance();
+
+    // Reads every fixture in the directory. Returns the number read
+    int load(const char *directory);
+
+    void configure(const FixtureSettings &settings);
+    const FixtureSettings &settings() const { return _settings; }
+
+    const FixtureCounters &counters() const { return _counters; }
+    FixtureCounters &counters() { return _counters; }
+
+    // True if there is a fixture for the host
+    bool knows(const char *host) const;
+
+    // Draws whether the next lookup, connect or response fails
+    bool fault();
+    FixtureFault responseFault(size_t length, size_t *cut);
+
+    // Moves the kernel clock by the given number of round trips
+    void delay(int roundTrips) const;
+
+    // Picks the answer to a complete request. Returns false if there is no fixture for its host
+    bool respond(const char *request, const string **response, bool *close);
+
+    // Unix time in us on the NTP responder's clock at the given kernel time
+    int64_t ntpTimeUs(Kernel::Clock::time_point time) const;
+
+    // Answers an SNTP request like a stratum 2 server, holding it for FIXTURE_NTP_HOLD_MS. Returns false
+    // if the request isn't from a client
+    bool ntpRespond(const uint8_t *request, size_t length, uint8_t *response);
+
+private:
+    FixtureServer();
+
+    const Fixture *find(const char *host, bool gzip) const;
+    bool read(const string &path, const string &host, bool gzip);
+
+    vector<Fixture> _fixtures;
+    FixtureSettings _settings;
+    FixtureCounters _counters;
+    std::mt19937 _random;
+};
+
+// The server side of one TCP connection. Collects the request and hands out the response in pieces
+class FixtureConnection {
+public:
+    nsapi_size_or_error_t send(const void *data, nsapi_size_t length);
+    nsapi_size_or_error_t recv(void *data, nsapi_size_t length, int timeout);
+
+private:
+    char _request[FIXTURE_REQUEST_SIZE];
+    size_t _requestLength = 0;
+
+    const string *_response = nullptr;
+    size_t _position = 0;
+    bool _waiting = false;
+    bool _close = false;
+    bool _closed = false;
+
+    FixtureFault _fault = FaultNone;
+    size_t _cut = 0;
+};
+
+#endif // SMARTWATCH_FIXTURE_SERVER_H
@@ -0,0 +1,34 @@
+/**
+ * @file   hostCheck.h
+ * @author Tobias Kallevik
+*/
+
+#ifndef SMARTWATCH_HOST_CHECK_H
+#define SMARTWATCH_HOST_CHECK_H
+
+#include <cstddef>
+#include <string>
+
+// Sizes the input of a check is fed in. One byte makes a parser stop at every possible point
+extern const size_t checkFeedSizes[4];
+
+// Counts the checks of one part, and prints the ones that fail
+class CheckCount {
+public:
+    CheckCount(const char *part) : _part(part), _run(0), _failed(0) {}
+
+    void expect(bool passed, const char *name, size_t feedSize);
+
+    // Prints how many checks ran and failed. Returns true if none failed
+    bool report(const char *against);
+
+private:
+    const char *_part;
+    int _run;
+    int _failed;
+};
+
+// The body of a fixture, after the first empty line. Empty if the file is missing
+std::string fixtureBody(const std::string &path);
+
+#endif // SMARTWATCH_HOST_CHECK_H
@@ -0,0 +1,15 @@
+/**
+ * @file   inflaterCheck.h
+ * @author Tobias Kallevik
+*/
+
+#ifndef SMARTWATCH_INFLATER_CHECK_H
+#define SMARTWATCH_INFLATER_CHECK_H
+
+// Decodes streams made by zlib with the GzipDecoder, fed in parts of several sizes, and compares the
+// output with what was compressed. Also decodes the gzip variant of the RSS fixture against the plain
+// one, and checks that early stops, corrupted data and a wrong CRC are caught. Prints a line for each
+// failure and a summary. Returns true if everything passed
+bool checkInflater(const char *fixtureDirectory);
+
+#endif // SMARTWATCH_INFLATER_CHECK_H
@@ -0,0 +1,273 @@
+/**
+ * @file   mbed.h
+ * @author Tobias Kallevik
+*/
+
+// Stand-in for the parts of Mbed OS used by the fetchers, so they can be built and run on Linux.
+// Only what the sources in the host build use is here. The network and TLS are replaced by the
+// fixture server in fixtureServer.h
+
+#ifndef SMARTWATCH_HOST_MBED_H
+#define SMARTWATCH_HOST_MBED_H
+
+// Includes
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <string>
+
+// Network error codes, with the values Mbed OS uses
+typedef int32_t nsapi_error_t;
+typedef int32_t nsapi_value_or_error_t;
+typedef int32_t nsapi_size_or_error_t;
+typedef uint32_t nsapi_size_t;
+typedef int nsapi_version_t;
+
+enum {
+    NSAPI_ERROR_OK = 0,
+    NSAPI_ERROR_WOULD_BLOCK = -3001,
+    NSAPI_ERROR_UNSUPPORTED = -3002,
+    NSAPI_ERROR_PARAMETER = -3003,
+    NSAPI_ERROR_NO_CONNECTION = -3004,
+    NSAPI_ERROR_NO_SOCKET = -3005,
+    NSAPI_ERROR_NO_ADDRESS = -3006,
+    NSAPI_ERROR_NO_MEMORY = -3007,
+    NSAPI_ERROR_DNS_FAILURE = -3009,
+    NSAPI_ERROR_AUTH_FAILURE = -3011,
+    NSAPI_ERROR_DEVICE_ERROR = -3012,
+    NSAPI_ERROR_IN_PROGRESS = -3013,
+    NSAPI_ERROR_ALREADY = -3014,
+    NSAPI_ERROR_IS_CONNECTED = -3015,
+    NSAPI_ERROR_CONNECTION_LOST = -3016,
+    NSAPI_ERROR_CONNECTION_TIMEOUT = -3017,
+    NSAPI_ERROR_TIMEOUT = -3019,
+    NSAPI_ERROR_BUSY = -3020
+};
+
+enum nsapi_connection_status_t {
+    NSAPI_STATUS_LOCAL_UP = 0,
+    NSAPI_STATUS_GLOBAL_UP = 1,
+    NSAPI_STATUS_DISCONNECTED = 2,
+    NSAPI_STATUS_CONNECTING = 3
+};
+
+enum nsapi_event_t {
+    NSAPI_EVENT_CONNECTION_STATUS_CHANGE = 0
+};
+
+namespace mbed {
+
+// Callback on top of std::function, with the object and method form used by the sources
+template <typename F>
+class Callback;
+
+template <typename R, typename... Args>
+class Callback<R(Args...)> : public std::function<R(Args...)> {
+public:
+    Callback() {}
+    Callback(R (*function)(Args...)) : std::function<R(Args...)>(function) {}
+
+    template <typename T, typename U>
+    Callback(U *object, R (T::*method)(Args...))
+        : std::function<R(Args...)>([object, method](Args... args) { return (object->*method)(args...); }) {}
+};
+
+template <typename R, typename... Args>
+Callback<R(Args...)> callback(R (*function)(Args...)) {
+    return Callback<R(Args...)>(function);
+}
+
+template <typename T, typename U, typename R, typename... Args>
+Callback<R(Args...)> callback(U *object, R (T::*method)(Args...)) {
+    return Callback<R(Args...)>(object, method);
+}
+
+// Internal flash, with only the last sector backed by memory. That is the one the persistent store uses
+class FlashIAP {
+public:
+    int init() { return 0; }
+    int deinit() { return 0; }
+    int read(void *buffer, uint32_t address, uint32_t size);
+    int program(const void *buffer, uint32_t address, uint32_t size);
+    int erase(uint32_t address, uint32_t size);
+
+    uint32_t get_flash_start() const { return 0x08000000; }
+    uint32_t get_flash_size() const { return 0x100000; }
+    uint32_t get_sector_size(uint32_t) const { return 2048; }
+    uint32_t get_page_size() const { return 8; }
+    uint8_t get_erase_value() const { return 0xff; }
+};
+
+} // namespace mbed
+
+namespace rtos {
+
+// RTOS mutexes are recursive
+class Mutex {
+public:
+    void lock() { _mutex.lock(); }
+    void unlock() { _mutex.unlock(); }
+    bool trylock() { return _mutex.try_lock(); }
+
+private:
+    std::recursive_mutex _mutex;
+};
+
+class ConditionVariable {
+public:
+    ConditionVariable(Mutex &mutex) : _mutex(mutex) {}
+
+    void wait() { _condition.wait(_mutex); }
+    void notify_one() { _condition.notify_one(); }
+    void notify_all() { _condition.notify_all(); }
+
+private:
+    Mutex &_mutex;
+    std::condition_variable_any _condition;
+};
+
+namespace Kernel {
+
+// Kernel clock in ms. It runs with the host clock, plus the simulated time of the network, which is
+// added with hostClockAdvance() instead of being slept. A benchmark then measures the real work done,
+// while the request timings still show the latency of the link
+struct Clock {
+    typedef std::chrono::milliseconds duration;
+    typedef duration::rep rep;
+    typedef duration::period period;
+    typedef std::chrono::time_point<Clock, duration> time_point;
+    static const bool is_steady = true;
+
+    static time_point now();
+};
+
+} // namespace Kernel
+
+namespace ThisThread {
+void sleep_for(Kernel::Clock::duration time);
+}
+
+} // namespace rtos
+
+using namespace mbed;
+using namespace rtos;
+using namespace std;
+
+// Adds simulated time to the kernel clock. Host only
+void hostClockAdvance(std::chrono::milliseconds time);
+
+// Sleeps by moving the kernel clock
+void thread_sleep_for(uint32_t ms);
+
+// The host RTC can't be set, so this is ignored
+inline void set_time(time_t) {}
+
+// Atomics used by the sources
+inline bool core_util_atomic_load_bool(const volatile bool *value) {
+    return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+}
+
+inline void core_util_atomic_store_bool(volatile bool *value, bool desired) {
+    __atomic_store_n(value, desired, __ATOMIC_SEQ_CST);
+}
+
+inline uint32_t core_util_atomic_load_u32(const volatile uint32_t *value) {
+    return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+}
+
+inline void core_util_atomic_store_u32(volatile uint32_t *value, uint32_t desired) {
+    __atomic_store_n(value, desired, __ATOMIC_SEQ_CST);
+}
+
+inline uint32_t core_util_atomic_incr_u32(volatile uint32_t *value, uint32_t delta) {
+    return __atomic_add_fetch(value, delta, __ATOMIC_SEQ_CST);
+}
+
+// Address of a host. The fixture server hands out made up IPv4 addresses
+class SocketAddress {
+public:
+    SocketAddress() : _port(0) { _ip[0] = '\0'; }
+    SocketAddress(const char *ip, uint16_t port = 0) : _port(port) { set_ip_address(ip); }
+
+    bool set_ip_address(const char *ip);
+    const char *get_ip_address() const { return _ip[0] != '\0' ? _ip : nullptr; }
+    void set_port(uint16_t port) { _port = port; }
+    uint16_t get_port() const { return _port; }
+    explicit operator bool() const { return _ip[0] != '\0'; }
+
+private:
+    char _ip[16];
+    uint16_t _port;
+};
+
+// Network interface that is always up. Host names resolve if the fixture server has a response for them
+class NetworkInterface {
+public:
+    virtual ~NetworkInterface() {}
+
+    nsapi_error_t connect();
+    nsapi_error_t disconnect();
+    nsapi_connection_status_t get_connection_status() const { return _status; }
+    void attach(mbed::Callback<void(nsapi_event_t, intptr_t)> status) { _statusCallback = status; }
+
+    nsapi_error_t gethostbyname(const char *host, SocketAddress *address, nsapi_version_t version = 0, const char *interfaceName = nullptr);
+
+    // Lookups are answered at once, so there is no asynchronous form. The DNS cache then looks the host up when it expires
+    nsapi_value_or_error_t gethostbyname_async(const char *, mbed::Callback<void(nsapi_error_t, SocketAddress *)>,
+                                               nsapi_version_t = 0, const char * = nullptr) {
+        return NSAPI_ERROR_UNSUPPORTED;
+    }
+
+private:
+    void setStatus(nsapi_connection_status_t status);
+
+    nsapi_connection_status_t _status = NSAPI_STATUS_DISCONNECTED;
+    mbed::Callback<void(nsapi_event_t, intptr_t)> _statusCallback;
+};
+
+class FixtureConnection;
+
+// TCP socket connected to the fixture server instead of the network
+class TCPSocket {
+public:
+    TCPSocket();
+    ~TCPSocket();
+
+    nsapi_error_t open(NetworkInterface *network);
+    nsapi_error_t close();
+    void set_timeout(int timeout) { _timeout = timeout; }
+
+    nsapi_error_t connect(const SocketAddress &address);
+    nsapi_size_or_error_t send(const void *data, nsapi_size_t length);
+    nsapi_size_or_error_t recv(void *data, nsapi_size_t length);
+
+private:
+    FixtureConnection *_connection;
+    int _timeout;
+};
+
+// UDP socket answered by the NTP responder of the fixture server. Holds the one datagram it answers with
+class UDPSocket {
+public:
+    UDPSocket() : _answerLength(0), _timeout(-1) {}
+
+    nsapi_error_t open(NetworkInterface *network) { return network != nullptr ? NSAPI_ERROR_OK : NSAPI_ERROR_NO_SOCKET; }
+    nsapi_error_t close() { _answerLength = 0; return NSAPI_ERROR_OK; }
+    void set_timeout(int timeout) { _timeout = timeout; }
+
+    nsapi_size_or_error_t sendto(const SocketAddress &address, const void *data, nsapi_size_t length);
+    nsapi_size_or_error_t recvfrom(SocketAddress *address, void *data, nsapi_size_t length);
+
+private:
+    SocketAddress _peer;
+    uint8_t _answer[48];
+    size_t _answerLength;
+    int _timeout;
+};
+
+#endif // SMARTWATCH_HOST_MBED_H
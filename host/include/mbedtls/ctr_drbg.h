@@ -0,0 +1,15 @@
+/**
+ * @file   ctr_drbg.h
+ * @author Tobias Kallevik
+*/
+
+// Stand-in for the mbed TLS type used by tlsContext.h. The host build doesn't encrypt, so it holds nothing
+
+#ifndef SMARTWATCH_HOST_MBEDTLS_CTR_DRBG_H
+#define SMARTWATCH_HOST_MBEDTLS_CTR_DRBG_H
+
+typedef struct {
+    int unused;
+} mbedtls_ctr_drbg_context;
+
+#endif // SMARTWATCH_HOST_MBEDTLS_CTR_DRBG_H
@@ -0,0 +1,15 @@
+/**
+ * @file   entropy.h
+ * @author Tobias Kallevik
+*/
+
+// Stand-in for the mbed TLS type used by tlsContext.h. The host build doesn't encrypt, so it holds nothing
+
+#ifndef SMARTWATCH_HOST_MBEDTLS_ENTROPY_H
+#define SMARTWATCH_HOST_MBEDTLS_ENTROPY_H
+
+typedef struct {
+    int unused;
+} mbedtls_entropy_context;
+
+#endif // SMARTWATCH_HOST_MBEDTLS_ENTROPY_H
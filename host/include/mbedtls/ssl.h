@@ -0,0 +1,24 @@
+/**
+ * @file   ssl.h
+ * @author Tobias Kallevik
+*/
+
+// Stand-in for the mbed TLS types used by tlsContext.h. The host build doesn't encrypt, so they hold no keys or certificates
+
+#ifndef SMARTWATCH_HOST_MBEDTLS_SSL_H
+#define SMARTWATCH_HOST_MBEDTLS_SSL_H
+
+typedef struct {
+    int unused;
+} mbedtls_ssl_config;
+
+typedef struct {
+    int unused;
+} mbedtls_ssl_session;
+
+// Set by the stand-in TlsContext when it offers a saved session, so the handshake can take the shorter, resumed path
+typedef struct {
+    int resumed;
+} mbedtls_ssl_context;
+
+#endif // SMARTWATCH_HOST_MBEDTLS_SSL_H
@@ -0,0 +1,15 @@
+/**
+ * @file   x509_crt.h
+ * @author Tobias Kallevik
+*/
+
+// Stand-in for the mbed TLS type used by tlsContext.h. The host build doesn't encrypt, so it holds nothing
+
+#ifndef SMARTWATCH_HOST_MBEDTLS_X509_CRT_H
+#define SMARTWATCH_HOST_MBEDTLS_X509_CRT_H
+
+typedef struct {
+    int unused;
+} mbedtls_x509_crt;
+
+#endif // SMARTWATCH_HOST_MBEDTLS_X509_CRT_H
@@ -0,0 +1,16 @@
+/**
+ * @file   parserCheck.h
+ * @author Tobias Kallevik
+*/
+
+#ifndef SMARTWATCH_PARSER_CHECK_H
+#define SMARTWATCH_PARSER_CHECK_H
+
+// Runs the receive ring, the HTTP response parser, the JSON extractor and the RSS parser over known
+// input fed in parts of several sizes, and the recorded responses the fetchers use. Covers
+// Content-Length, chunked and until-close bodies, header lines split across receives and around the
+// end of the ring, and broken input. Prints a line for each failure and a summary. Returns true if
+// everything passed
+bool checkParsers(const char *fixtureDirectory);
+
+#endif // SMARTWATCH_PARSER_CHECK_H
@@ -0,0 +1,364 @@
+/**
+ * @file   bench.cpp
+ * @author Tobias Kallevik
+*/
+
+// Runs the fetchers against the fixture server and reports how fast they parse, and how much they
+// allocate, per fetcher. Built by host/CMakeLists.txt, see README.md
+
+#include "apiThreads.h"
+#include "fixtureServer.h"
+#include "inflaterCheck.h"
+#include "parserCheck.h"
+#include "ipgeolocation_ca_certificate.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <unistd.h>
+
+// Fixtures used when --fixtures isn't given. Set by CMake to host/fixtures
+#ifndef BENCH_FIXTURE_DIR
+#define BENCH_FIXTURE_DIR "fixtures"
+#endif
+
+// Space kept before each allocation for its size, keeping the alignment malloc gives
+#define HEAP_HEADER_SIZE 16
+
+// How far in us the SNTP client's time and delay may be off. The kernel clock counts whole ms, and a round
+// trip of an odd number of ms can't be split evenly
+#define BENCH_SNTP_TOLERANCE_US 2000
+
+// Heap use by operator new, which is where the fetchers, the parsers and std::string allocate
+struct HeapStats {
+    uint64_t allocations;
+    int64_t live;
+    int64_t peak;
+};
+
+static HeapStats heap;
+
+static void *heapAllocate(size_t size) {
+    char *block = static_cast<char *>(malloc(size + HEAP_HEADER_SIZE));
+    if (block == nullptr) {
+        return nullptr;
+    }
+
+    *reinterpret_cast<size_t *>(block) = size;
+    heap.allocations++;
+    heap.live += size;
+    if (heap.live > heap.peak) {
+        heap.peak = heap.live;
+    }
+    return block + HEAP_HEADER_SIZE;
+}
+
+static void heapFree(void *pointer) {
+    if (pointer == nullptr) {
+        return;
+    }
+
+    char *block = static_cast<char *>(pointer) - HEAP_HEADER_SIZE;
+    heap.live -= *reinterpret_cast<size_t *>(block);
+    free(block);
+}
+
+void *operator new(size_t size) {
+    void *pointer = heapAllocate(size);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    return heapAllocate(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+    return heapAllocate(size);
+}
+
+void operator delete(void *pointer) noexcept {
+    heapFree(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+    heapFree(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept {
+    heapFree(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept {
+    heapFree(pointer);
+}
+
+void operator delete(void *pointer, const std::nothrow_t &) noexcept {
+    heapFree(pointer);
+}
+
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept {
+    heapFree(pointer);
+}
+
+// Sends stdout to /dev/null while the fetchers run, since they log every request
+class QuietOutput {
+public:
+    QuietOutput(bool quiet) : _saved(-1) {
+        if (!quiet) {
+            return;
+        }
+        fflush(stdout);
+        _saved = dup(STDOUT_FILENO);
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        ::close(null);
+    }
+
+    ~QuietOutput() {
+        if (_saved < 0) {
+            return;
+        }
+        fflush(stdout);
+        dup2(_saved, STDOUT_FILENO);
+        ::close(_saved);
+    }
+
+private:
+    int _saved;
+};
+
+struct BenchOptions {
+    int iterations = 100;
+    const char *fixtures = BENCH_FIXTURE_DIR;
+    FixtureSettings link;
+
+    // Sends the validators of the last response, so unchanged sources get a 304
+    bool conditional = false;
+
+    // Closes the pooled connections and forgets the TLS session before every run
+    bool cold = false;
+
+    bool verbose = false;
+};
+
+struct Fetcher {
+    const char *name;
+    nsapi_error_t (*fetch)(SharedData *sharedData);
+};
+
+// What the runs of one fetcher added up to
+struct FetcherResult {
+    int runs = 0;
+    int succeeded = 0;
+    int64_t hostUs = 0;
+    int64_t clockMs = 0;
+    uint64_t allocations = 0;
+    int64_t peakHeap = 0;
+    FixtureCounters server;
+};
+
+static void printUsage(const char *program) {
+    printf("Usage: %s [options]\n"
+           "  --iterations N    Runs of each fetcher (100)\n"
+           "  --chunk N         Most bytes a socket receive returns (1460)\n"
+           "  --latency MS      Round trip time added to the kernel clock (0)\n"
+           "  --fault-rate P    Chance of a failed lookup, connect or response, 0 to 1 (0)\n"
+           "  --seed N          Seed of the fault generator (1)\n"
+           "  --fixtures DIR    Directory of the recorded responses (%s)\n"
+           "  --conditional     Keep the validators between runs, so unchanged responses are 304\n"
+           "  --cold            Close pooled connections and forget TLS sessions before each run\n"
+           "  --verbose         Show the output of the fetchers\n",
+           program, BENCH_FIXTURE_DIR);
+}
+
+static bool parseOptions(int argc, char **argv, BenchOptions *options) {
+    for (int i = 1; i < argc; i++) {
+        const char *option = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool takesValue = true;
+
+        if (strcmp(option, "--iterations") == 0 && value != nullptr) {
+            options->iterations = atoi(value);
+        } else if (strcmp(option, "--chunk") == 0 && value != nullptr) {
+            options->link.chunkSize = strtoul(value, nullptr, 10);
+        } else if (strcmp(option, "--latency") == 0 && value != nullptr) {
+            options->link.latencyMs = atoi(value);
+        } else if (strcmp(option, "--fault-rate") == 0 && value != nullptr) {
+            options->link.faultRate = atof(value);
+        } else if (strcmp(option, "--seed") == 0 && value != nullptr) {
+            options->link.seed = strtoul(value, nullptr, 10);
+        } else if (strcmp(option, "--fixtures") == 0 && value != nullptr) {
+            options->fixtures = value;
+        } else {
+            takesValue = false;
+            if (strcmp(option, "--conditional") == 0) {
+                options->conditional = true;
+            } else if (strcmp(option, "--cold") == 0) {
+                options->cold = true;
+            } else if (strcmp(option, "--verbose") == 0) {
+                options->verbose = true;
+            } else {
+                return false;
+            }
+        }
+
+        if (takesValue) {
+            i++;
+        }
+    }
+
+    return options->iterations > 0 && options->link.chunkSize > 0;
+}
+
+// Runs the fetcher the given number of times, after one run that isn't counted. That run reads the
+// fixtures into the caches and opens the pooled connection, like the first fetch after boot
+static FetcherResult runFetcher(const Fetcher &fetcher, SharedData *sharedData, const BenchOptions &options) {
+    FetcherResult result;
+    QuietOutput quiet(!options.verbose);
+    FixtureServer &server = FixtureServer::instance();
+
+    fetcher.fetch(sharedData);
+    server.counters() = FixtureCounters();
+
+    for (int i = 0; i < options.iterations; i++) {
+        if (options.cold) {
+            sharedData->http.closeAll();
+            sharedData->ipgeolocationTls.clearSession();
+        }
+        if (!options.conditional) {
+            sharedData->weatherValidators = HttpValidators();
+            sharedData->rssValidators = HttpValidators();
+        }
+
+        uint64_t allocations = heap.allocations;
+        int64_t live = heap.live;
+        heap.peak = heap.live;
+        steady_clock::time_point hostStart = steady_clock::now();
+        Kernel::Clock::time_point clockStart = Kernel::Clock::now();
+
+        bool succeeded = fetcher.fetch(sharedData) == NSAPI_ERROR_OK;
+
+        result.clockMs += duration_cast<milliseconds>(Kernel::Clock::now() - clockStart).count();
+        result.hostUs += duration_cast<microseconds>(steady_clock::now() - hostStart).count();
+        result.allocations += heap.allocations - allocations;
+        result.peakHeap = max(result.peakHeap, heap.peak - live);
+        result.runs++;
+        result.succeeded += succeeded;
+    }
+
+    result.server = server.counters();
+    return result;
+}
+
+static void printResult(const Fetcher &fetcher, const FetcherResult &result) {
+    double runs = result.runs;
+    double bytesPerRun = result.server.bytesSent / runs;
+    double usPerRun = result.hostUs / runs;
+    double megabytesPerSecond = result.hostUs > 0 ? result.server.bytesSent / (double)result.hostUs : 0;
+
+    printf("%-8s %6d %6d %6d %10.0f %9.1f %9.2f %9.1f %10.1f %10lld\n",
+           fetcher.name, result.runs, result.succeeded, result.runs - result.succeeded,
+           bytesPerRun, usPerRun, megabytesPerSecond, result.clockMs / runs,
+           result.allocations / runs, (long long)result.peakHeap);
+}
+
+// Asks the NTP responder for the time without faults. The client must come out with the responder's clock at
+// the time the answer arrived, and with the round trip of the link as the delay, leaving out the hold
+static bool checkSntp(SharedData *sharedData, const BenchOptions &options) {
+    FixtureServer &server = FixtureServer::instance();
+    FixtureSettings link = options.link;
+    link.faultRate = 0;
+    server.configure(link);
+
+    SntpTime time;
+    Kernel::Clock::time_point receivedAt;
+    nsapi_error_t result = sharedData->sntp.query(&time, &receivedAt);
+    server.configure(options.link);
+
+    if (result != NSAPI_ERROR_OK) {
+        printf("\nsntp     query failed: %d\n", result);
+        return false;
+    }
+
+    int64_t offsetUs = time.unixTimeUs - server.ntpTimeUs(receivedAt);
+    int64_t delayErrorUs = time.delayUs - (int64_t)link.latencyMs * 1000;
+    bool passed = llabs(offsetUs) <= BENCH_SNTP_TOLERANCE_US && llabs(delayErrorUs) <= BENCH_SNTP_TOLERANCE_US;
+
+    printf("\nsntp     offset %+.1f ms, delay %.1f ms for a %d ms round trip, stratum %d: %s\n",
+           offsetUs / 1000.0, time.delayUs / 1000.0, link.latencyMs, time.stratum, passed ? "ok" : "FAILED");
+    return passed;
+}
+
+static void printServer(const Fetcher &fetcher, const FetcherResult &result) {
+    printf("%-8s %8u %8u %10u %8u %8u %8u\n",
+           fetcher.name, result.server.lookups, result.server.connects, result.server.handshakes,
+           result.server.requests, result.server.notModified, result.server.faults);
+}
+
+int main(int argc, char **argv) {
+    BenchOptions options;
+    if (!parseOptions(argc, argv, &options)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    FixtureServer &server = FixtureServer::instance();
+    if (server.load(options.fixtures) == 0) {
+        printf("No fixtures found in %s\n", options.fixtures);
+        return 1;
+    }
+    server.configure(options.link);
+
+    // Set up like connectToNetwork does on the board. Static since it's too big for the stack there, and kept the same here
+    static SharedData sharedData;
+    static NetworkInterface network;
+    network.connect();
+    sharedData.network = &network;
+    sharedData.dns.setNetwork(&network);
+    sharedData.http.setNetwork(&network, &sharedData.dns);
+    sharedData.sntp.setNetwork(&network, &sharedData.dns);
+    sharedData.ipgeolocationTls.init(ipgeolocation_ca_certificate);
+
+    const Fetcher fetchers[] = {
+        {"time", fetchTime},
+        {"clock", fetchClock},
+        {"weather", fetchWeather},
+        {"rss", fetchRss}
+    };
+    const int fetcherCount = sizeof(fetchers) / sizeof(fetchers[0]);
+    FetcherResult results[fetcherCount];
+
+    for (int i = 0; i < fetcherCount; i++) {
+        results[i] = runFetcher(fetchers[i], &sharedData, options);
+    }
+
+    printf("%d runs per fetcher, chunk %zu B, latency %d ms, fault rate %.3f, seed %u%s%s\n\n",
+           options.iterations, options.link.chunkSize, options.link.latencyMs, options.link.faultRate,
+           options.link.seed, options.conditional ? ", conditional" : "", options.cold ? ", cold" : "");
+
+    // Throughput is of the host CPU, with the link latency left out. The kernel clock time includes it
+    printf("%-8s %6s %6s %6s %10s %9s %9s %9s %10s %10s\n",
+           "fetcher", "runs", "ok", "failed", "bytes/run", "us/run", "MB/s", "ms/run", "allocs/run", "peak heap");
+    for (int i = 0; i < fetcherCount; i++) {
+        printResult(fetchers[i], results[i]);
+    }
+
+    printf("\n%-8s %8s %8s %10s %8s %8s %8s\n",
+           "server", "lookups", "connects", "handshakes", "requests", "304s", "faults");
+    for (int i = 0; i < fetcherCount; i++) {
+        printServer(fetchers[i], results[i]);
+    }
+
+    bool passed = checkSntp(&sharedData, options);
+    passed = checkInflater(options.fixtures) && passed;
+    passed = checkParsers(options.fixtures) && passed;
+    return passed ? 0 : 1;
+}
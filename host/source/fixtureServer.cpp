@@ -0,0 +1,334 @@
+/**
+ * @file   fixtureServer.cpp
+ * @author Tobias Kallevik
+*/
+
+#include "fixtureServer.h"
+#include "sntpClient.h"
+#include <algorithm>
+#include <cstdio>
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include <strings.h>
+
+// Copies the value of the header from a block of CRLF separated lines, without the surrounding spaces.
+// Header names are compared without regard to case. The value is empty if the header is missing
+static void headerValue(const char *head, const char *name, char *value, size_t size) {
+    size_t nameLength = strlen(name);
+    value[0] = '\0';
+
+    for (const char *line = head; *line != '\0';) {
+        const char *end = strstr(line, "\r\n");
+        if (end == nullptr) {
+            end = line + strlen(line);
+        }
+
+        if ((size_t)(end - line) > nameLength && line[nameLength] == ':' && strncasecmp(line, name, nameLength) == 0) {
+            const char *first = line + nameLength + 1;
+            while (first < end && (*first == ' ' || *first == '\t')) {
+                first++;
+            }
+            const char *last = end;
+            while (last > first && (last[-1] == ' ' || last[-1] == '\t')) {
+                last--;
+            }
+            size_t length = min<size_t>(last - first, size - 1);
+            memcpy(value, first, length);
+            value[length] = '\0';
+            return;
+        }
+
+        line = *end == '\0' ? end : end + 2;
+    }
+}
+
+FixtureServer &FixtureServer::instance() {
+    static FixtureServer server;
+    return server;
+}
+
+FixtureServer::FixtureServer() : _random(1) {
+}
+
+int FixtureServer::load(const char *directory) {
+    DIR *dir = opendir(directory);
+    if (dir == nullptr) {
+        printf("Failed to open fixture directory %s\n", directory);
+        return 0;
+    }
+
+    int count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        string name = entry->d_name;
+        const string plainEnding = ".http";
+        const string gzipEnding = ".gz.http";
+        if (name.size() <= plainEnding.size() || name.compare(name.size() - plainEnding.size(), plainEnding.size(), plainEnding) != 0) {
+            continue;
+        }
+
+        bool gzip = name.size() > gzipEnding.size() && name.compare(name.size() - gzipEnding.size(), gzipEnding.size(), gzipEnding) == 0;
+        string host = name.substr(0, name.size() - (gzip ? gzipEnding : plainEnding).size());
+        if (read(string(directory) + "/" + name, host, gzip)) {
+            count++;
+        }
+    }
+
+    closedir(dir);
+    return count;
+}
+
+// Splits the file at the first empty line. The header lines may end in LF or CRLF, and are sent with CRLF
+bool FixtureServer::read(const string &path, const string &host, bool gzip) {
+    ifstream file(path, ios::binary);
+    stringstream contents;
+    contents << file.rdbuf();
+    string text = contents.str();
+
+    size_t split = text.find("\n\n");
+    size_t bodyStart = split + 2;
+    size_t crlfSplit = text.find("\r\n\r\n");
+    if (crlfSplit != string::npos && (split == string::npos || crlfSplit < split)) {
+        split = crlfSplit;
+        bodyStart = crlfSplit + 4;
+    }
+    if (split == string::npos) {
+        printf("Fixture %s has no empty line after the headers\n", path.c_str());
+        return false;
+    }
+
+    string head;
+    istringstream lines(text.substr(0, split));
+    string line;
+    while (getline(lines, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        head += line + "\r\n";
+    }
+    string body = text.substr(bodyStart);
+
+    char value[FIXTURE_VALUE_SIZE];
+    Fixture fixture;
+    fixture.host = host;
+    fixture.gzip = gzip;
+    headerValue(head.c_str(), "ETag", value, sizeof(value));
+    fixture.etag = value;
+    headerValue(head.c_str(), "Connection", value, sizeof(value));
+    fixture.close = strstr(value, "close") != nullptr;
+    headerValue(head.c_str(), "Transfer-Encoding", value, sizeof(value));
+    bool chunked = strstr(value, "chunked") != nullptr;
+
+    fixture.notModified = "HTTP/1.1 304 Not Modified\r\nETag: " + fixture.etag + "\r\n";
+    if (fixture.close) {
+        fixture.notModified += "Connection: close\r\n";
+    }
+    fixture.notModified += "\r\n";
+
+    fixture.response = head;
+    if (!chunked) {
+        fixture.response += "Content-Length: " + to_string(body.size()) + "\r\n\r\n" + body;
+    } else {
+        fixture.response += "\r\n";
+        for (size_t position = 0; position < body.size(); position += FIXTURE_HTTP_CHUNK_SIZE) {
+            size_t length = min<size_t>(FIXTURE_HTTP_CHUNK_SIZE, body.size() - position);
+            char size[16];
+            snprintf(size, sizeof(size), "%zx\r\n", length);
+            fixture.response += size;
+            fixture.response.append(body, position, length);
+            fixture.response += "\r\n";
+        }
+        fixture.response += "0\r\n\r\n";
+    }
+
+    _fixtures.push_back(fixture);
+    return true;
+}
+
+void FixtureServer::configure(const FixtureSettings &settings) {
+    _settings = settings;
+    _settings.chunkSize = max<size_t>(_settings.chunkSize, 1);
+    _random.seed(settings.seed);
+}
+
+// The NTP server the client asks has no fixture, and is answered by ntpRespond
+bool FixtureServer::knows(const char *host) const {
+    return strcmp(host, MBED_CONF_APP_SNTP_SERVER) == 0 || find(host, false) != nullptr || find(host, true) != nullptr;
+}
+
+const Fixture *FixtureServer::find(const char *host, bool gzip) const {
+    for (const Fixture &fixture : _fixtures) {
+        if (fixture.host == host && fixture.gzip == gzip) {
+            return &fixture;
+        }
+    }
+    return nullptr;
+}
+
+bool FixtureServer::fault() {
+    if (_settings.faultRate <= 0) {
+        return false;
+    }
+
+    bool hit = uniform_real_distribution<double>(0, 1)(_random) < _settings.faultRate;
+    if (hit) {
+        _counters.faults++;
+    }
+    return hit;
+}
+
+// Cuts the response somewhere after the status line has started, so the client has begun reading it
+FixtureFault FixtureServer::responseFault(size_t length, size_t *cut) {
+    if (length < 2 || !fault()) {
+        return FaultNone;
+    }
+
+    *cut = uniform_int_distribution<size_t>(1, length - 1)(_random);
+    return uniform_int_distribution<int>(0, 1)(_random) == 0 ? FaultReset : FaultStall;
+}
+
+void FixtureServer::delay(int roundTrips) const {
+    hostClockAdvance(milliseconds(roundTrips * _settings.latencyMs));
+}
+
+// Picks the fixture from the Host header, using the gzip variant if the client accepts it. A request whose
+// If-None-Match holds the fixture's ETag gets a 304 with no body
+bool FixtureServer::respond(const char *request, const string **response, bool *close) {
+    static const string notFound = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+    _counters.requests++;
+
+    char host[FIXTURE_VALUE_SIZE];
+    char encoding[FIXTURE_VALUE_SIZE];
+    char etag[FIXTURE_VALUE_SIZE];
+    headerValue(request, "Host", host, sizeof(host));
+    headerValue(request, "Accept-Encoding", encoding, sizeof(encoding));
+    headerValue(request, "If-None-Match", etag, sizeof(etag));
+    char *port = strchr(host, ':');
+    if (port != nullptr) {
+        *port = '\0';
+    }
+
+    const Fixture *fixture = strstr(encoding, "gzip") != nullptr ? find(host, true) : nullptr;
+    if (fixture == nullptr) {
+        fixture = find(host, false);
+    }
+    if (fixture == nullptr) {
+        *response = &notFound;
+        *close = false;
+        return false;
+    }
+
+    *close = fixture->close;
+    if (!fixture->etag.empty() && fixture->etag == etag) {
+        _counters.notModified++;
+        *response = &fixture->notModified;
+    } else {
+        *response = &fixture->response;
+    }
+    return true;
+}
+
+int64_t FixtureServer::ntpTimeUs(Kernel::Clock::time_point time) const {
+    return FIXTURE_NTP_BASE_US + duration_cast<microseconds>(time.time_since_epoch()).count();
+}
+
+// Converts unix time in us to a 32.32 fixed point NTP timestamp, counted from 1900
+static uint64_t ntpTimestamp(int64_t unixUs) {
+    uint64_t seconds = unixUs / 1000000 + 2208988800ULL;
+    uint64_t fraction = ((uint64_t)(unixUs % 1000000) << 32) / 1000000;
+    return (seconds << 32) | fraction;
+}
+
+static void writeNtpTimestamp(uint8_t *data, uint64_t value) {
+    for (int i = 7; i >= 0; i--) {
+        data[i] = value & 0xFF;
+        value >>= 8;
+    }
+}
+
+// The originate timestamp echoes the client's transmit timestamp, which is how the client matches the answer
+bool FixtureServer::ntpRespond(const uint8_t *request, size_t length, uint8_t *response) {
+    if (length < FIXTURE_NTP_PACKET_SIZE || (request[0] & 0x07) != 3) {
+        return false;
+    }
+
+    uint64_t receive = ntpTimestamp(ntpTimeUs(Kernel::Clock::now()));
+    hostClockAdvance(milliseconds(FIXTURE_NTP_HOLD_MS));
+    uint64_t transmit = ntpTimestamp(ntpTimeUs(Kernel::Clock::now()));
+
+    memset(response, 0, FIXTURE_NTP_PACKET_SIZE);
+    // Leap indicator 0, version 4, mode 4 (server), stratum 2
+    response[0] = (0 << 6) | (4 << 3) | 4;
+    response[1] = 2;
+    memcpy(response + 24, request + 40, 8);
+    writeNtpTimestamp(response + 32, receive);
+    writeNtpTimestamp(response + 40, transmit);
+    return true;
+}
+
+// Answers once the request is complete. Only one request is in flight at a time, like from the HTTP client
+nsapi_size_or_error_t FixtureConnection::send(const void *data, nsapi_size_t length) {
+    if (_closed) {
+        return NSAPI_ERROR_CONNECTION_LOST;
+    }
+
+    // A request too long for the buffer is cut, which only loses headers the server doesn't look at
+    FixtureServer &server = FixtureServer::instance();
+    server.counters().bytesReceived += length;
+    size_t count = min<size_t>(length, sizeof(_request) - 1 - _requestLength);
+    memcpy(_request + _requestLength, data, count);
+    _requestLength += count;
+    _request[_requestLength] = '\0';
+
+    char *end = strstr(_request, "\r\n\r\n");
+    if (end != nullptr || _requestLength == sizeof(_request) - 1) {
+        server.respond(_request, &_response, &_close);
+        _requestLength = 0;
+        _position = 0;
+        _waiting = true;
+        _fault = server.responseFault(_response->size(), &_cut);
+    }
+
+    return length;
+}
+
+// Hands out the response in pieces of at most the chunk size. The first piece comes a round trip after the request
+nsapi_size_or_error_t FixtureConnection::recv(void *data, nsapi_size_t length, int timeout) {
+    if (_closed) {
+        return 0;
+    }
+
+    if (_response == nullptr || _position >= _response->size()) {
+        if (_close && _response != nullptr) {
+            _closed = true;
+            return 0;
+        }
+        hostClockAdvance(milliseconds(max(timeout, 0)));
+        return NSAPI_ERROR_WOULD_BLOCK;
+    }
+
+    if (_waiting) {
+        FixtureServer::instance().delay(1);
+        _waiting = false;
+    }
+
+    size_t end = _response->size();
+    if (_fault != FaultNone) {
+        if (_position >= _cut) {
+            if (_fault == FaultReset) {
+                _closed = true;
+                return NSAPI_ERROR_CONNECTION_LOST;
+            }
+            hostClockAdvance(milliseconds(max(timeout, 0)));
+            return NSAPI_ERROR_WOULD_BLOCK;
+        }
+        end = _cut;
+    }
+
+    size_t count = min({(size_t)length, FixtureServer::instance().settings().chunkSize, end - _position});
+    memcpy(data, _response->data() + _position, count);
+    _position += count;
+    FixtureServer::instance().counters().bytesSent += count;
+    return count;
+}
@@ -0,0 +1,40 @@
+/**
+ * @file   hostCheck.cpp
+ * @author Tobias Kallevik
+*/
+
+#include "hostCheck.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+const size_t checkFeedSizes[4] = {1, 3, 7, 512};
+
+void CheckCount::expect(bool passed, const char *name, size_t feedSize) {
+    _run++;
+    if (!passed) {
+        _failed++;
+        printf("%s %s, fed %zu bytes at a time: FAILED\n", _part, name, feedSize);
+    }
+}
+
+bool CheckCount::report(const char *against) {
+    printf("\n%s %d checks against %s, %d failed: %s\n", _part, _run, against, _failed, _failed == 0 ? "ok" : "FAILED");
+    return _failed == 0;
+}
+
+string fixtureBody(const string &path) {
+    ifstream file(path, ios::binary);
+    stringstream contents;
+    contents << file.rdbuf();
+    string text = contents.str();
+
+    size_t split = text.find("\r\n\r\n");
+    if (split != string::npos) {
+        return text.substr(split + 4);
+    }
+    split = text.find("\n\n");
+    return split != string::npos ? text.substr(split + 2) : string();
+}
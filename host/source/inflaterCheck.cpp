@@ -0,0 +1,169 @@
+/**
+ * @file   inflaterCheck.cpp
+ * @author Tobias Kallevik
+*/
+
+#include "inflaterCheck.h"
+#include "hostCheck.h"
+#include "inflater.h"
+#include <cstdio>
+#include <random>
+#include <string>
+#include <zlib.h>
+
+using namespace std;
+
+// Output of one decode, and the byte after which the handler stops the stream if it is not 0
+struct DecodeOutput {
+    string data;
+    size_t stopAfter = 0;
+};
+
+static bool collect(void *context, const char *data, size_t length) {
+    DecodeOutput *output = static_cast<DecodeOutput *>(context);
+    output->data.append(data, length);
+    return output->stopAfter == 0 || output->data.size() < output->stopAfter;
+}
+
+enum DecodeEnd {
+    EndDone,
+    EndStopped,
+    EndFailed,
+    EndIncomplete
+};
+
+static DecodeEnd decode(const string &gzip, size_t feedSize, DecodeOutput *output) {
+    GzipDecoder decoder(collect, output);
+    if (!decoder.init()) {
+        return EndFailed;
+    }
+
+    for (size_t position = 0; position < gzip.size(); position += feedSize) {
+        size_t length = min(feedSize, gzip.size() - position);
+        if (!decoder.feed(gzip.data() + position, length)) {
+            return decoder.failed() ? EndFailed : EndStopped;
+        }
+    }
+    return decoder.done() ? EndDone : decoder.failed() ? EndFailed : EndIncomplete;
+}
+
+// Compresses with zlib into a gzip stream. A name, a comment, an extra field and a header CRC are added if named
+static string compress(const string &data, int level, int strategy, bool named) {
+    z_stream stream = {};
+    deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, strategy);
+
+    gz_header header = {};
+    char name[] = "feed.xml";
+    char comment[] = "fixture";
+    unsigned char extra[] = {'S', 'W', 2, 0, 1, 2};
+    if (named) {
+        header.name = reinterpret_cast<Bytef *>(name);
+        header.comment = reinterpret_cast<Bytef *>(comment);
+        header.extra = extra;
+        header.extra_len = sizeof(extra);
+        header.hcrc = 1;
+        deflateSetHeader(&stream, &header);
+    }
+
+    string out(deflateBound(&stream, data.size()) + 64, '\0');
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+    stream.avail_in = data.size();
+    stream.next_out = reinterpret_cast<Bytef *>(&out[0]);
+    stream.avail_out = out.size();
+    deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return out;
+}
+
+// Every feed size must decode the stream to the original data
+static void expectDecodes(CheckCount *count, const char *name, const string &gzip, const string &original) {
+    for (size_t feedSize : checkFeedSizes) {
+        DecodeOutput output;
+        DecodeEnd end = decode(gzip, feedSize, &output);
+        count->expect(end == EndDone && output.data == original, name, feedSize);
+    }
+}
+
+bool checkInflater(const char *fixtureDirectory) {
+    CheckCount count("inflater");
+
+    // The feed, three times over so matches reach back across the whole window as it wraps
+    string feed = fixtureBody(string(fixtureDirectory) + "/feeds.feedburner.com.http");
+    string text = feed + feed + feed;
+    string random(100000, '\0');
+    mt19937 generator(1);
+    for (char &c : random) {
+        c = static_cast<char>(generator());
+    }
+
+    expectDecodes(&count, "stored", compress(text, 0, Z_DEFAULT_STRATEGY, false), text);
+    expectDecodes(&count, "fixed", compress(text, 6, Z_FIXED, false), text);
+    expectDecodes(&count, "dynamic", compress(text, 9, Z_DEFAULT_STRATEGY, false), text);
+    expectDecodes(&count, "rle", compress(text, 6, Z_RLE, false), text);
+    expectDecodes(&count, "random", compress(random, 6, Z_DEFAULT_STRATEGY, false), random);
+    expectDecodes(&count, "named header", compress(text, 6, Z_DEFAULT_STRATEGY, true), text);
+    expectDecodes(&count, "empty", compress(string(), 6, Z_DEFAULT_STRATEGY, false), string());
+
+    // The recorded gzip response holds the same body as the plain one
+    string recorded = fixtureBody(string(fixtureDirectory) + "/feeds.feedburner.com.gz.http");
+    count.expect(!feed.empty() && !recorded.empty(), "fixtures found", 0);
+    expectDecodes(&count, "recorded feed", recorded, feed);
+
+    string gzip = compress(text, 6, Z_DEFAULT_STRATEGY, false);
+    for (size_t feedSize : checkFeedSizes) {
+        // The handler stops the stream, which is neither an error nor done, and no more output follows
+        DecodeOutput stopped;
+        stopped.stopAfter = 5000;
+        DecodeEnd end = decode(gzip, feedSize, &stopped);
+        count.expect(end == EndStopped && stopped.data.size() < stopped.stopAfter + INFLATE_WINDOW_SIZE &&
+                     text.compare(0, stopped.data.size(), stopped.data) == 0, "early stop", feedSize);
+
+        // A flipped bit in the compressed data breaks the stream or its CRC
+        string corrupted = gzip;
+        corrupted[corrupted.size() / 2] ^= 0x10;
+        DecodeOutput corruptedOutput;
+        count.expect(decode(corrupted, feedSize, &corruptedOutput) == EndFailed, "corrupted data", feedSize);
+
+        // The data is fine but the trailer CRC isn't
+        string wrongCrc = gzip;
+        wrongCrc[wrongCrc.size() - 8] ^= 0x01;
+        DecodeOutput wrongCrcOutput;
+        count.expect(decode(wrongCrc, feedSize, &wrongCrcOutput) == EndFailed, "wrong CRC", feedSize);
+
+        // A cut stream never reports done
+        DecodeOutput cutOutput;
+        count.expect(decode(gzip.substr(0, gzip.size() - 4), feedSize, &cutOutput) == EndIncomplete, "cut stream", feedSize);
+    }
+
+    // A stored stream starts its first block right after the 10 byte gzip header: the block type byte,
+    // then LEN and its complement NLEN
+    string stored = compress(text, 0, Z_DEFAULT_STRATEGY, false);
+    for (size_t feedSize : checkFeedSizes) {
+        string badLength = stored;
+        badLength[13] ^= 0x01;
+        DecodeOutput badLengthOutput;
+        count.expect(decode(badLength, feedSize, &badLengthOutput) == EndFailed, "stored length mismatch", feedSize);
+
+        string reserved = stored;
+        reserved[10] = 0x07;
+        DecodeOutput reservedOutput;
+        count.expect(decode(reserved, feedSize, &reservedOutput) == EndFailed, "reserved block type", feedSize);
+
+        string badMagic = stored;
+        badMagic[1] = 0x00;
+        DecodeOutput badMagicOutput;
+        count.expect(decode(badMagic, feedSize, &badMagicOutput) == EndFailed, "not gzip", feedSize);
+
+        // Cut in the header, in a stored block header, in stored data, and in the data of a compressed block
+        const size_t storedCuts[] = {4, 10, 12, stored.size() / 2};
+        for (size_t cut : storedCuts) {
+            DecodeOutput cutStoredOutput;
+            count.expect(decode(stored.substr(0, cut), feedSize, &cutStoredOutput) == EndIncomplete, "cut stored stream", feedSize);
+        }
+        DecodeOutput cutMiddleOutput;
+        count.expect(decode(gzip.substr(0, gzip.size() / 2), feedSize, &cutMiddleOutput) == EndIncomplete, "cut in a block", feedSize);
+    }
+
+    return count.report("zlib and the fixtures");
+}
@@ -0,0 +1,229 @@
+/**
+ * @file   mbed.cpp
+ * @author Tobias Kallevik
+*/
+
+#include "mbed.h"
+#include "fixtureServer.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Simulated time added to the host clock, in ms
+static atomic<int64_t> simulatedMs(0);
+
+void hostClockAdvance(std::chrono::milliseconds time) {
+    simulatedMs += time.count();
+}
+
+Kernel::Clock::time_point Kernel::Clock::now() {
+    milliseconds host = duration_cast<milliseconds>(steady_clock::now().time_since_epoch());
+    return time_point(host + milliseconds(simulatedMs.load()));
+}
+
+void ThisThread::sleep_for(Kernel::Clock::duration time) {
+    hostClockAdvance(time);
+}
+
+void thread_sleep_for(uint32_t ms) {
+    hostClockAdvance(milliseconds(ms));
+}
+
+// The last sector of the flash. The rest of it holds the application on the board, which can't be read here
+static uint8_t lastSector[2048];
+static bool lastSectorErased = false;
+
+static uint8_t *flashAt(const FlashIAP &flash, uint32_t address, uint32_t size) {
+    uint32_t start = flash.get_flash_start() + flash.get_flash_size() - sizeof(lastSector);
+    if (!lastSectorErased) {
+        memset(lastSector, flash.get_erase_value(), sizeof(lastSector));
+        lastSectorErased = true;
+    }
+    if (address < start || address + size > start + sizeof(lastSector)) {
+        return nullptr;
+    }
+    return lastSector + (address - start);
+}
+
+int FlashIAP::read(void *buffer, uint32_t address, uint32_t size) {
+    uint8_t *flash = flashAt(*this, address, size);
+    if (flash == nullptr) {
+        return -1;
+    }
+    memcpy(buffer, flash, size);
+    return 0;
+}
+
+int FlashIAP::program(const void *buffer, uint32_t address, uint32_t size) {
+    uint8_t *flash = flashAt(*this, address, size);
+    if (flash == nullptr) {
+        return -1;
+    }
+    memcpy(flash, buffer, size);
+    return 0;
+}
+
+int FlashIAP::erase(uint32_t address, uint32_t size) {
+    uint8_t *flash = flashAt(*this, address, size);
+    if (flash == nullptr) {
+        return -1;
+    }
+    memset(flash, get_erase_value(), size);
+    return 0;
+}
+
+bool SocketAddress::set_ip_address(const char *ip) {
+    if (ip == nullptr || strlen(ip) >= sizeof(_ip)) {
+        _ip[0] = '\0';
+        return false;
+    }
+    strcpy(_ip, ip);
+    return true;
+}
+
+nsapi_error_t NetworkInterface::connect() {
+    if (_status == NSAPI_STATUS_GLOBAL_UP) {
+        return NSAPI_ERROR_IS_CONNECTED;
+    }
+    FixtureServer::instance().delay(1);
+    setStatus(NSAPI_STATUS_GLOBAL_UP);
+    return NSAPI_ERROR_OK;
+}
+
+nsapi_error_t NetworkInterface::disconnect() {
+    setStatus(NSAPI_STATUS_DISCONNECTED);
+    return NSAPI_ERROR_OK;
+}
+
+void NetworkInterface::setStatus(nsapi_connection_status_t status) {
+    _status = status;
+    if (_statusCallback) {
+        _statusCallback(NSAPI_EVENT_CONNECTION_STATUS_CHANGE, status);
+    }
+}
+
+// Every host with a fixture gets a made up address in 10.0.0.0/24 that stays the same between runs
+nsapi_error_t NetworkInterface::gethostbyname(const char *host, SocketAddress *address, nsapi_version_t, const char *) {
+    FixtureServer &server = FixtureServer::instance();
+    server.counters().lookups++;
+    server.delay(1);
+
+    if (server.fault() || !server.knows(host)) {
+        return NSAPI_ERROR_DNS_FAILURE;
+    }
+
+    unsigned hash = 0;
+    for (const char *c = host; *c != '\0'; c++) {
+        hash = hash * 31 + (unsigned char)*c;
+    }
+    char ip[16];
+    snprintf(ip, sizeof(ip), "10.0.0.%u", 1 + hash % 254);
+    address->set_ip_address(ip);
+    return NSAPI_ERROR_OK;
+}
+
+// The server side of a connection isn't on the board, so it's taken straight from malloc. That keeps it
+// out of the heap use the benchmark counts through operator new
+static FixtureConnection *newConnection() {
+    void *memory = malloc(sizeof(FixtureConnection));
+    return memory != nullptr ? new (memory) FixtureConnection : nullptr;
+}
+
+static void deleteConnection(FixtureConnection *connection) {
+    if (connection != nullptr) {
+        connection->~FixtureConnection();
+        free(connection);
+    }
+}
+
+TCPSocket::TCPSocket() : _connection(nullptr), _timeout(-1) {
+}
+
+TCPSocket::~TCPSocket() {
+    close();
+}
+
+nsapi_error_t TCPSocket::open(NetworkInterface *network) {
+    return network != nullptr ? NSAPI_ERROR_OK : NSAPI_ERROR_NO_SOCKET;
+}
+
+nsapi_error_t TCPSocket::close() {
+    deleteConnection(_connection);
+    _connection = nullptr;
+    return NSAPI_ERROR_OK;
+}
+
+nsapi_error_t TCPSocket::connect(const SocketAddress &address) {
+    FixtureServer &server = FixtureServer::instance();
+    server.counters().connects++;
+    server.delay(1);
+
+    if (!address) {
+        return NSAPI_ERROR_NO_ADDRESS;
+    }
+    if (server.fault()) {
+        return NSAPI_ERROR_NO_CONNECTION;
+    }
+
+    deleteConnection(_connection);
+    _connection = newConnection();
+    return _connection != nullptr ? NSAPI_ERROR_OK : NSAPI_ERROR_NO_MEMORY;
+}
+
+nsapi_size_or_error_t TCPSocket::send(const void *data, nsapi_size_t length) {
+    if (_connection == nullptr) {
+        return NSAPI_ERROR_NO_CONNECTION;
+    }
+    return _connection->send(data, length);
+}
+
+nsapi_size_or_error_t TCPSocket::recv(void *data, nsapi_size_t length) {
+    if (_connection == nullptr) {
+        return NSAPI_ERROR_NO_CONNECTION;
+    }
+    return _connection->recv(data, length, _timeout);
+}
+
+// The request takes half the round trip to reach the responder. A lost request is only noticed when no answer comes
+nsapi_size_or_error_t UDPSocket::sendto(const SocketAddress &address, const void *data, nsapi_size_t length) {
+    FixtureServer &server = FixtureServer::instance();
+    server.counters().requests++;
+    server.counters().bytesReceived += length;
+    _answerLength = 0;
+
+    if (!address) {
+        return NSAPI_ERROR_NO_ADDRESS;
+    }
+    if (server.fault()) {
+        return length;
+    }
+
+    _peer = address;
+    hostClockAdvance(milliseconds(server.settings().latencyMs / 2));
+    if (server.ntpRespond(static_cast<const uint8_t *>(data), length, _answer)) {
+        _answerLength = FIXTURE_NTP_PACKET_SIZE;
+    }
+    return length;
+}
+
+// The answer takes the rest of the round trip to come back
+nsapi_size_or_error_t UDPSocket::recvfrom(SocketAddress *address, void *data, nsapi_size_t length) {
+    FixtureServer &server = FixtureServer::instance();
+    if (_answerLength == 0) {
+        hostClockAdvance(milliseconds(max(_timeout, 0)));
+        return NSAPI_ERROR_WOULD_BLOCK;
+    }
+
+    int latency = server.settings().latencyMs;
+    hostClockAdvance(milliseconds(latency - latency / 2));
+
+    size_t count = min<size_t>(length, _answerLength);
+    memcpy(data, _answer, count);
+    _answerLength = 0;
+    server.counters().bytesSent += count;
+    if (address != nullptr) {
+        *address = _peer;
+    }
+    return count;
+}
@@ -0,0 +1,346 @@
+/**
+ * @file   parserCheck.cpp
+ * @author Tobias Kallevik
+*/
+
+#include "parserCheck.h"
+#include "hostCheck.h"
+#include "httpResponseParser.h"
+#include "jsonExtractor.h"
+#include "recvRing.h"
+#include "rssParser.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Body passed on by the response parser, and the byte after which the handler stops it if it is not 0
+struct BodyOutput {
+    string data;
+    size_t stopAfter = 0;
+};
+
+static bool collectBody(void *context, const char *data, size_t length) {
+    BodyOutput *output = static_cast<BodyOutput *>(context);
+    output->data.append(data, length);
+    return output->stopAfter == 0 || output->data.size() < output->stopAfter;
+}
+
+enum ParseEnd {
+    ParseDone,
+    ParseStopped,
+    ParseFailed,
+    ParseIncomplete
+};
+
+// Receives the input into a ring and parses it the way HttpClient::readResponse does. The end of the
+// input is the server closing the connection
+static ParseEnd parseResponse(const string &input, size_t feedSize, HttpResponse *response, BodyOutput *body) {
+    RecvRing ring;
+    HttpResponseParser parser(response, collectBody, body);
+    size_t position = 0;
+
+    while (true) {
+        if (position == input.size()) {
+            if (parser.closed()) {
+                return ParseDone;
+            }
+            return parser.failed() ? ParseFailed : ParseIncomplete;
+        }
+
+        // The parser always leaves room, so a full ring means it is stuck
+        ByteSpan space = ring.space();
+        if (space.length == 0) {
+            return ParseFailed;
+        }
+
+        size_t length = min({feedSize, space.length, input.size() - position});
+        memcpy(space.data, input.data() + position, length);
+        ring.commit(length);
+        position += length;
+
+        if (!parser.feed(&ring)) {
+            break;
+        }
+    }
+
+    if (parser.done()) {
+        return ParseDone;
+    }
+    return parser.stopped() ? ParseStopped : ParseFailed;
+}
+
+// Header lines "X-Filler-n: ..." adding up to about the given size
+static string fillerHeaders(size_t size) {
+    string lines;
+    for (int i = 0; lines.size() < size; i++) {
+        lines += "X-Filler-" + to_string(i) + ": " + string(48, 'a' + i % 26) + "\r\n";
+    }
+    return lines;
+}
+
+static void checkRecvRing(CheckCount *count) {
+    // Moves a numbered byte stream through the ring in random steps, so it wraps around the end many times
+    mt19937 generator(2);
+    RecvRing ring;
+    uint8_t nextWritten = 0;
+    uint8_t nextRead = 0;
+    bool inOrder = true;
+    bool spansFit = true;
+    bool sawFull = false;
+    bool sawWrap = false;
+
+    for (int i = 0; i < 20000; i++) {
+        ByteSpan space = ring.space();
+        size_t write = space.length > 0 ? generator() % (space.length + 1) : 0;
+        spansFit &= space.length <= RECV_RING_SIZE - ring.size();
+        for (size_t j = 0; j < write; j++) {
+            space.data[j] = static_cast<char>(nextWritten++);
+        }
+        ring.commit(write);
+        sawFull |= ring.full();
+
+        ByteSpan front = ring.front();
+        spansFit &= front.length <= ring.size();
+        sawWrap |= front.length < ring.size();
+        size_t read = front.length > 0 ? generator() % (front.length + 1) : 0;
+        for (size_t j = 0; j < read; j++) {
+            inOrder &= static_cast<uint8_t>(front.data[j]) == nextRead++;
+        }
+        ring.consume(read);
+    }
+    count->expect(inOrder && spansFit && sawFull && sawWrap, "ring keeps bytes in order across its end", 0);
+
+    // Emptying the ring starts it over, so the next receive gets all of it in one span
+    ring.clear();
+    ring.commit(RECV_RING_SIZE - 10);
+    ring.consume(RECV_RING_SIZE - 10);
+    count->expect(ring.size() == 0 && ring.space().length == RECV_RING_SIZE, "empty ring starts over", 0);
+}
+
+static void checkHttpParser(CheckCount *count) {
+    for (size_t feedSize : checkFeedSizes) {
+        HttpResponse response;
+        BodyOutput body;
+
+        // Content-Length, with bytes after the body that aren't part of it
+        ParseEnd end = parseResponse("HTTP/1.1 200 OK\r\nContent-Length: 11\r\nETag: \"v1\"\r\n"
+                                     "Last-Modified: Sat, 17 Oct 2026 09:10:00 GMT\r\nKeep-Alive: timeout=5\r\n\r\nhello worldNEXT",
+                                     feedSize, &response, &body);
+        count->expect(end == ParseDone && response.status == 200 && body.data == "hello world" && response.keepAlive &&
+                      response.keepAliveTimeout == 5 && response.etag == "\"v1\"" &&
+                      response.lastModified == "Sat, 17 Oct 2026 09:10:00 GMT", "content-length", feedSize);
+
+        // Chunked, with an extension, a chunk size in capitals and a trailer. Chunked wins over a length
+        response = HttpResponse();
+        body = BodyOutput();
+        end = parseResponse("HTTP/1.1 200 OK\r\nContent-Length: 3\r\nTransfer-Encoding: chunked\r\n\r\n"
+                            "5\r\nhello\r\n1;name=value\r\n \r\nA\r\n0123456789\r\n0\r\nX-Trailer: 1\r\n\r\n",
+                            feedSize, &response, &body);
+        count->expect(end == ParseDone && response.chunked && body.data == "hello 0123456789", "chunked", feedSize);
+
+        // A chunk size that isn't hex, and chunk data without its line end
+        response = HttpResponse();
+        body = BodyOutput();
+        end = parseResponse("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\nhello\r\n0\r\n\r\n", feedSize, &response, &body);
+        count->expect(end == ParseFailed, "bad chunk size", feedSize);
+        response = HttpResponse();
+        body = BodyOutput();
+        end = parseResponse("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhelloXX\r\n0\r\n\r\n", feedSize, &response, &body);
+        count->expect(end == ParseFailed, "chunk without line end", feedSize);
+
+        // Without a length the body lasts until the server closes, and the connection can't be kept
+        response = HttpResponse();
+        body = BodyOutput();
+        end = parseResponse("HTTP/1.0 200 OK\r\nContent-Encoding: gzip\r\n\r\nuntil close", feedSize, &response, &body);
+        count->expect(end == ParseDone && body.data == "until close" && !response.keepAlive && response.gzip, "until close", feedSize);
+
+        // A 100 Continue before the real response, and a 304 that has no body even with a length
+        response = HttpResponse();
+        body = BodyOutput();
+        end = parseResponse("HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 304 Not Modified\r\nContent-Length: 50\r\n\r\n", feedSize, &response, &body);
+        count->expect(end == ParseDone && response.status == 304 && body.data.empty(), "continue and 304", feedSize);
+
+        // The handler stops the body part way
+        response = HttpResponse();
+        body = BodyOutput();
+        body.stopAfter = 4;
+        end = parseResponse("HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\n0123456789", feedSize, &response, &body);
+        count->expect(end == ParseStopped && body.data.size() >= 4 && body.data.compare(0, 4, "0123") == 0, "stopped body", feedSize);
+
+        // Not a status line
+        response = HttpResponse();
+        body = BodyOutput();
+        end = parseResponse("SMTP ready\r\n\r\n", feedSize, &response, &body);
+        count->expect(end == ParseFailed, "bad status line", feedSize);
+
+        // A header line too long to keep is cut, and the lines after it are still read
+        response = HttpResponse();
+        body = BodyOutput();
+        end = parseResponse("HTTP/1.1 200 OK\r\nX-Long: " + string(600, 'x') + "\r\nContent-Length: 2\r\n\r\nok", feedSize, &response, &body);
+        count->expect(end == ParseDone && body.data == "ok", "long header line", feedSize);
+
+        // A header bigger than the limit
+        response = HttpResponse();
+        body = BodyOutput();
+        end = parseResponse("HTTP/1.1 200 OK\r\n" + fillerHeaders(HTTP_MAX_HEADER_SIZE) + "Content-Length: 2\r\n\r\nok", feedSize, &response, &body);
+        count->expect(end == ParseFailed, "header too big", feedSize);
+    }
+
+    // A header longer than the ring. Receives that nearly fill it leave the start of a line at its end, so
+    // the line wraps around and is copied out
+    const size_t wrapFeedSizes[] = {1, 7, 1000, 1021};
+    for (size_t feedSize : wrapFeedSizes) {
+        HttpResponse response;
+        BodyOutput body;
+        ParseEnd end = parseResponse("HTTP/1.1 200 OK\r\n" + fillerHeaders(RECV_RING_SIZE + 300) +
+                                     "ETag: \"wrapped\"\r\nContent-Length: 4\r\n\r\nbody", feedSize, &response, &body);
+        count->expect(end == ParseDone && response.etag == "\"wrapped\"" && body.data == "body", "header around the ring end", feedSize);
+    }
+}
+
+// Feeds a JSON document in parts of the given size
+static bool extract(JsonExtractor *extractor, const string &document, size_t feedSize) {
+    extractor->reset();
+    for (size_t position = 0; position < document.size(); position += feedSize) {
+        if (!extractor->feed(document.data() + position, min(feedSize, document.size() - position))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool valueIs(const JsonExtractor &extractor, const char *path, const char *expected) {
+    const char *value = extractor.value(path);
+    return value != nullptr && strcmp(value, expected) == 0;
+}
+
+static void checkJsonExtractor(CheckCount *count, const char *fixtureDirectory) {
+    const string document =
+        "garbage before {\"date_time_unix\": 1792228364.123, \"geo\": {\"latitude\": \"58.34081\", \"longitude\": \"8.59334\","
+        " \"state_prov\": \"Agder \\\"Fylke\\\"\\n\\u0041\\u00e9\\/\"}, \"list\": [1, {\"name\": \"x\"}],"
+        " \"flag\": true, \"none\": null, \"deep\": {\"a\": {\"b\": {\"c\": -5e2}}}, \"empty\": {}, \"long\": \"" + string(80, 'L') + "\"}";
+
+    for (size_t feedSize : checkFeedSizes) {
+        JsonField fields[] = {
+            {"date_time_unix"},
+            {"geo.latitude"},
+            {"geo.state_prov"},
+            {"list[].name"},
+            {"flag"},
+            {"none"},
+            {"deep.a.b.c"},
+            {"long"},
+            {"geo.city"}
+        };
+        JsonExtractor extractor(fields, sizeof(fields) / sizeof(fields[0]));
+        bool fed = extract(&extractor, document, feedSize);
+        count->expect(fed && extractor.done() && valueIs(extractor, "date_time_unix", "1792228364.123") &&
+                      valueIs(extractor, "geo.latitude", "58.34081") && valueIs(extractor, "geo.state_prov", "Agder \"Fylke\"\nA?/") &&
+                      valueIs(extractor, "list[].name", "x") && valueIs(extractor, "flag", "true") && valueIs(extractor, "none", "null") &&
+                      valueIs(extractor, "deep.a.b.c", "-5e2") && valueIs(extractor, "long", string(JSON_VALUE_SIZE - 1, 'L').c_str()),
+                      "json values", feedSize);
+        count->expect(extractor.value("geo.city") == nullptr && !extractor.foundAll(), "json missing field", feedSize);
+
+        // Brackets that don't match, a bad \u escape and nesting deeper than the limit
+        count->expect(!extract(&extractor, "{\"a\": [1, 2}", feedSize) && extractor.failed(), "json bad bracket", feedSize);
+        count->expect(!extract(&extractor, "{\"a\": \"\\u00g0\"}", feedSize) && extractor.failed(), "json bad escape", feedSize);
+        count->expect(!extract(&extractor, string(JSON_MAX_DEPTH + 1, '['), feedSize) && extractor.failed(), "json too deep", feedSize);
+
+        // The recorded responses have the fields the fetchers use
+        JsonField timeFields[] = {
+            {"date_time_unix"},
+            {"timezone_offset_with_dst"},
+            {"geo.latitude"},
+            {"geo.longitude"},
+            {"geo.state_prov"}
+        };
+        JsonExtractor timeExtractor(timeFields, sizeof(timeFields) / sizeof(timeFields[0]));
+        fed = extract(&timeExtractor, fixtureBody(string(fixtureDirectory) + "/api.ipgeolocation.io.http"), feedSize);
+        count->expect(fed && timeExtractor.done() && timeExtractor.foundAll() && valueIs(timeExtractor, "geo.state_prov", "Agder"),
+                      "json time fixture", feedSize);
+
+        JsonField weatherFields[] = {
+            {"current.temp_c"},
+            {"current.condition.text"}
+        };
+        JsonExtractor weatherExtractor(weatherFields, sizeof(weatherFields) / sizeof(weatherFields[0]));
+        fed = extract(&weatherExtractor, fixtureBody(string(fixtureDirectory) + "/api.weatherapi.com.http"), feedSize);
+        count->expect(fed && weatherExtractor.done() && valueIs(weatherExtractor, "current.temp_c", "9.4") &&
+                      valueIs(weatherExtractor, "current.condition.text", "Light rain shower"), "json weather fixture", feedSize);
+    }
+}
+
+// Titles found by the RSS parser, by item
+struct RssOutput {
+    vector<string> titles;
+};
+
+static void collectTitle(void *context, int item, const char *title) {
+    RssOutput *output = static_cast<RssOutput *>(context);
+    if (output->titles.size() <= (size_t)item) {
+        output->titles.resize(item + 1);
+    }
+    output->titles[item] = title;
+}
+
+// Feeds a feed in parts of the given size. Returns the parser's items once it has all it wants or the feed ends
+static int parseFeed(const string &feed, size_t feedSize, int maxItems, RssOutput *output) {
+    RssParser parser(maxItems, collectTitle, output);
+    for (size_t position = 0; position < feed.size(); position += feedSize) {
+        if (!parser.feed(feed.data() + position, min(feedSize, feed.size() - position))) {
+            break;
+        }
+    }
+    return parser.items();
+}
+
+static void checkRssParser(CheckCount *count, const char *fixtureDirectory) {
+    const string feed =
+        "<?xml version=\"1.0\"?><!DOCTYPE rss><rss version='2.0'><channel>\n"
+        "  <title>Feed &amp; News</title><image><title>Image title</title></image>\n"
+        "  <!-- <item><title>Commented out</title></item> -->\n"
+        "  <item><title><![CDATA[First ]] <b>one</b>]]></title><link href=\"a>b\"/></item>\n"
+        "  <item attr='x>y'><title>Second&#8217;s \n\t  title &#x41; &bogus;thing &notanentityatall</title></item>\n"
+        "  <item><title/></item>\n"
+        "  <item><title>Fourth</title></item>\n"
+        "</channel></rss>";
+
+    RssOutput fixtureFirst;
+    string fixture = fixtureBody(string(fixtureDirectory) + "/feeds.feedburner.com.http");
+
+    for (size_t feedSize : checkFeedSizes) {
+        RssOutput output;
+        int items = parseFeed(feed, feedSize, 3, &output);
+        count->expect(items == 3 && output.titles.size() == 4 && output.titles[0] == "Feed & News" &&
+                      output.titles[1] == "First ]] <b>one</b>" && output.titles[2] == "Second's title A ?thing &notanentityatall" &&
+                      output.titles[3].empty(), "rss titles", feedSize);
+
+        // The recorded feed gives the same titles however it is split
+        RssOutput fixtureOutput;
+        items = parseFeed(fixture, feedSize, 3, &fixtureOutput);
+        if (feedSize == checkFeedSizes[0]) {
+            fixtureFirst = fixtureOutput;
+        }
+        bool titled = fixtureOutput.titles.size() == 4;
+        for (const string &title : fixtureOutput.titles) {
+            titled &= !title.empty();
+        }
+        count->expect(items == 3 && titled && fixtureOutput.titles == fixtureFirst.titles, "rss fixture", feedSize);
+    }
+}
+
+bool checkParsers(const char *fixtureDirectory) {
+    CheckCount count("parsers");
+
+    checkRecvRing(&count);
+    checkHttpParser(&count);
+    checkJsonExtractor(&count, fixtureDirectory);
+    checkRssParser(&count, fixtureDirectory);
+
+    return count.report("known input and the fixtures");
+}
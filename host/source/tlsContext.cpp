@@ -0,0 +1,94 @@
+/**
+ * @file   tlsContext.cpp
+ * @author Tobias Kallevik
+*/
+
+// Host stand-in for source/tlsContext.cpp. Nothing is encrypted, the data goes straight through the
+// socket. The handshake only costs the round trips of a real one: two for a full handshake and one
+// when the saved session is resumed
+
+#include "tlsContext.h"
+#include "fixtureServer.h"
+
+TlsContext::TlsContext() {
+}
+
+TlsContext::~TlsContext() {
+}
+
+nsapi_error_t TlsContext::init(const char *caCert) {
+    _mutex.lock();
+    _ready = caCert != nullptr;
+    _mutex.unlock();
+    return _ready ? NSAPI_ERROR_OK : NSAPI_ERROR_PARAMETER;
+}
+
+void TlsContext::restoreSession(mbedtls_ssl_context *ssl) {
+    _mutex.lock();
+    ssl->resumed = _hasSession;
+    _mutex.unlock();
+}
+
+void TlsContext::saveSession(const mbedtls_ssl_context *) {
+    _mutex.lock();
+    _hasSession = true;
+    _mutex.unlock();
+}
+
+void TlsContext::clearSession() {
+    _mutex.lock();
+    _hasSession = false;
+    _mutex.unlock();
+}
+
+TlsStream::TlsStream(TlsContext *context, TCPSocket *socket) : _context(context), _socket(socket) {
+    _ssl.resumed = 0;
+}
+
+TlsStream::~TlsStream() {
+    close();
+}
+
+nsapi_error_t TlsStream::handshake(const char *) {
+    FixtureServer &server = FixtureServer::instance();
+    server.counters().handshakes++;
+
+    _context->restoreSession(&_ssl);
+    server.delay(_ssl.resumed ? 1 : 2);
+
+    if (!_context->ready() || server.fault()) {
+        _context->clearSession();
+        return NSAPI_ERROR_AUTH_FAILURE;
+    }
+
+    _context->saveSession(&_ssl);
+    _connected = true;
+    return NSAPI_ERROR_OK;
+}
+
+nsapi_size_or_error_t TlsStream::send(const void *data, nsapi_size_t length) {
+    nsapi_size_or_error_t result = _socket->send(data, length);
+    return result < 0 ? NSAPI_ERROR_CONNECTION_LOST : result;
+}
+
+// Reports errors the way the real stream does, a timeout as would block and anything else as a lost connection
+nsapi_size_or_error_t TlsStream::recv(void *data, nsapi_size_t length) {
+    nsapi_size_or_error_t result = _socket->recv(data, length);
+    if (result >= 0 || result == NSAPI_ERROR_WOULD_BLOCK) {
+        return result;
+    }
+    return NSAPI_ERROR_CONNECTION_LOST;
+}
+
+void TlsStream::close() {
+    _connected = false;
+}
+
+// There is no record layer to feed, so the socket is used directly by send and recv
+int TlsStream::bioSend(void *, const unsigned char *, size_t) {
+    return 0;
+}
+
+int TlsStream::bioRecv(void *, unsigned char *, size_t) {
+    return 0;
+}
@@ -13,61 +13,139 @@
 #include <string>
 #include <vector>
 #include <sstream>
-#include "json.hpp"
+#include "jsonExtractor.h"
+#include "rssParser.h"
 #include "ISM43362Interface.h"
+#include "httpClient.h"
+#include "fetchQueue.h"
+#include "snapshot.h"
+#include "backoff.h"
+#include "sntpClient.h"
+#include "clockDiscipline.h"
+#include "refreshScheduler.h"
+#include "persistentStore.h"
+#include "networkManager.h"
+#include "fetchStats.h"
 
-// Namespaces
-using json = nlohmann::json;
+// Stack of the network thread. The TLS handshake is the deepest call it makes. Set in mbed_app.json
+#ifndef MBED_CONF_APP_NETWORK_THREAD_STACK_SIZE
+#define MBED_CONF_APP_NETWORK_THREAD_STACK_SIZE 6144
+#endif
 
-// Defenitons for the event flags
-#define mainFlagBtn (1 << 0) 
-#define timeFlagBtn (1 << 1) 
-#define weatherFlagBtn (1 << 2)
-#define rssFlagBtn (1 << 3)
+// Seconds between time API fetches. The clock is kept right with SNTP in between, so this only
+// has to catch changes to the timezone offset, like the switch to or from daylight saving time
+#define TIME_API_INTERVAL 86400
 
+// Freshness budgets in seconds for the refresh scheduler, while the screen is hidden and while it is shown,
+// and the shortest time between two fetches. The clock budget is set by the clock discipline
+#define WEATHER_FRESHNESS 1800
+#define WEATHER_VISIBLE_FRESHNESS 600
+#define WEATHER_MIN_INTERVAL 60
+#define RSS_FRESHNESS 3600
+#define RSS_VISIBLE_FRESHNESS 600
+#define RSS_MIN_INTERVAL 120
+#define CLOCK_MIN_INTERVAL 60
+
+// Number of news titles read from the RSS feed
+#define RSS_NEWS_ITEMS 3
+
+// Layout version of the cached data. Bump when CachedData changes
+#define CACHED_DATA_VERSION 1
+
+// An RTC reading before this (2023-01-01) means the clock was lost along with the power and must be fetched before it is shown
+#define RTC_VALID_AFTER 1672531200
+
+
+// Data from the time API
+struct TimeSnapshot {
+    int timezoneOffsetWithDst;
+    char latitude[JSON_VALUE_SIZE];
+    char longitude[JSON_VALUE_SIZE];
+};
+
+// Data from the weather API
+struct WeatherSnapshot {
+    int outdoorTemp;
+    char weatherCondition[JSON_VALUE_SIZE];
+};
+
+// Titles from the RSS feed
+struct RssSnapshot {
+    char rssFeedTitle[RSS_TITLE_SIZE];
+    char newsTitles[RSS_NEWS_ITEMS][RSS_TITLE_SIZE];
+};
+
+// Last good data, kept in flash so the screens have something to show right after a reset
+struct CachedData {
+    TimeSnapshot time;
+    WeatherSnapshot weather;
+    RssSnapshot rss;
+    char city[JSON_VALUE_SIZE];
+};
+
+static_assert(sizeof(CachedData) <= PERSIST_MAX_SIZE, "CachedData must fit in PERSIST_MAX_SIZE, or it is never saved");
 
 struct SharedData {
-    // Shared variables from time API
-    size_t epochTime = 0;
-    int timezoneOffsetWithDst = 0;
-    string latitude = 0;
-    string longitude = 0;
-    string city;
+    // Fetched data. Published by the network thread and read by the screens without locking
+    Snapshot<TimeSnapshot> timeSnapshot;
+    Snapshot<WeatherSnapshot> weatherSnapshot;
+    Snapshot<RssSnapshot> rssSnapshot;
 
-    // Shared variables from weather API
+    // City used for the weather. Set from the time API on the first run and changed by the user
+    string city;
     bool firstTimeApiRun = true;
-    string weatherCondition;
-    size_t outdoorTemp = 0;
 
-    // Shared variables from RSS 
-    string rssFeedTitle;
-    string newsTitle1;
-    string newsTitle2;
-    string newsTitle3;
-
-    // Time stamps for thread runs
+    // Time stamp for the last time API run
     time_t lastTimeApiRunTime = 0;
-    time_t lastWeatherApiRunTime = 0;
-    time_t lastRssRunTime = 0;
 
     // Shared network data
     NetworkInterface* network;
-    nsapi_connection_status_t status;
+    NetworkManager networkManager;
+    DnsCache dns;
+    HttpClient http;
+    TlsContext ipgeolocationTls;
+    SntpClient sntp;
+    ClockDiscipline clockDiscipline;
+
+    // Validators of the last used weather and RSS responses. Only used by the network thread
+    HttpValidators weatherValidators;
+    HttpValidators rssValidators;
+
+    // Fetch jobs waiting for the network thread, and the failures of each endpoint
+    FetchQueue fetchQueue;
+    CircuitBreaker fetchHealth[FetchJobCount];
 
-    // Event flags
-    EventFlags mainThreadFlag; 
-    EventFlags timeThreadFlag; 
-    EventFlags weatherThreadFlag; 
-    EventFlags rssThreadFlag; 
+    // Decides when each source is fetched
+    RefreshScheduler refresh;
 
-    // Mutex used to protect the struct
+    // Timing of the recent requests, recorded by the fetch functions
+    FetchStats stats;
+
+    // Flash copy of the last good data. Only written by the network thread
+    PersistentStore store;
+
+    // Mutex used to protect the city and the time stamps
     Mutex mutex;
 };
 
 
+// Returned by the fetch functions when the server answered, but with nothing that could be used. Outside the range of the NSAPI errors
+#define FETCH_ERROR_BAD_RESPONSE -4001
+
+// Fetch functions. They return NSAPI_ERROR_OK if the data was updated, the error of the request if it
+// failed, or FETCH_ERROR_BAD_RESPONSE if the response couldn't be used
+nsapi_error_t fetchTime(SharedData *sharedData);
+nsapi_error_t fetchClock(SharedData *sharedData);
+nsapi_error_t fetchWeather(SharedData *sharedData);
+nsapi_error_t fetchRss(SharedData *sharedData);
+
+// Publishes the data cached in flash. Returns false if there was none
+bool loadCachedData(SharedData *sharedData);
+
+// Writes the current data to flash once every source has been fetched. The store limits how often it is written
+void saveCachedData(SharedData *sharedData);
+
 // Thread function declarations
-void timeThreadFunc(void* arg);
-void weatherThreadFunc(void* arg);
-void rssThreadFunc(void* arg);
+void networkThreadFunc(void* arg);
 
 #endif // SMARTWATCH_API_THREADS_H
\ No newline at end of file
@@ -0,0 +1,87 @@
+/**
+ * @file   backoff.h
+ * @author Tobias Kallevik
+*/
+
+#ifndef SMARTWATCH_BACKOFF_H
+#define SMARTWATCH_BACKOFF_H
+
+// Includes
+#include "mbed.h"
+#include <chrono>
+#include <cstdint>
+
+using namespace std::chrono;
+
+// Wait in ms after the first failed fetch. Doubled for every failure after it. Set in mbed_app.json
+#ifndef MBED_CONF_APP_BACKOFF_BASE_MS
+#define MBED_CONF_APP_BACKOFF_BASE_MS 2000
+#endif
+
+// Longest wait in ms between two fetch attempts
+#ifndef MBED_CONF_APP_BACKOFF_MAX_MS
+#define MBED_CONF_APP_BACKOFF_MAX_MS 300000
+#endif
+
+// Failures in a row before the circuit opens and the endpoint is left alone
+#ifndef MBED_CONF_APP_CIRCUIT_FAILURE_THRESHOLD
+#define MBED_CONF_APP_CIRCUIT_FAILURE_THRESHOLD 5
+#endif
+
+// Seconds an open circuit waits before one test fetch is let through
+#ifndef MBED_CONF_APP_CIRCUIT_OPEN_TIME
+#define MBED_CONF_APP_CIRCUIT_OPEN_TIME 900
+#endif
+
+// Exponential backoff with jitter. The wait doubles for each failure up to a max, and a random part
+// keeps devices that failed at the same time from all retrying at the same time
+class Backoff {
+public:
+    Backoff(uint32_t baseMs, uint32_t maxMs);
+
+    // Returns the wait in ms before the next attempt and doubles the wait after it
+    uint32_t next();
+    void reset() { _attempt = 0; }
+
+private:
+    uint32_t _baseMs;
+    uint32_t _maxMs;
+    uint32_t _attempt;
+};
+
+enum CircuitState {
+    // Fetches are made, with backoff after a failure
+    CircuitClosed,
+    // Too many failures, so no fetches are made until the open time has passed
+    CircuitOpen,
+    // The open time has passed and one test fetch decides if the circuit closes again
+    CircuitHalfOpen
+};
+
+// Tracks failures of one endpoint and decides when it may be tried again
+class CircuitBreaker {
+public:
+    CircuitBreaker();
+
+    // True if a fetch may be made now. Moves an open circuit to half open once its time is up
+    bool allowed();
+
+    void succeeded();
+    void failed();
+
+    // Shown on the diagnostics screen
+    CircuitState state() const;
+    int failures() const;
+
+    // Seconds until the next fetch is allowed, 0 if it is allowed now
+    int retryIn() const;
+
+private:
+    Backoff _backoff;
+    CircuitState _state;
+    int _failures;
+    Kernel::Clock::time_point _retryAt;
+    mutable Mutex _mutex;
+};
+
+#endif // SMARTWATCH_BACKOFF_H
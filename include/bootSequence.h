@@ -0,0 +1,72 @@
+/**
+ * @file   bootSequence.h
+ * @author Tobias Kallevik
+*/
+
+#ifndef SMARTWATCH_BOOT_SEQUENCE_H
+#define SMARTWATCH_BOOT_SEQUENCE_H
+
+// Includes
+#include "mbed.h"
+#include <chrono>
+#include <cstdint>
+
+using namespace std::chrono;
+
+// Threads that run boot stages besides the main thread. Set in mbed_app.json
+#ifndef MBED_CONF_APP_BOOT_WORKERS
+#define MBED_CONF_APP_BOOT_WORKERS 2
+#endif
+
+// Stack of each boot worker. Must fit the deepest stage, the certificate parse. Set in mbed_app.json
+#ifndef MBED_CONF_APP_BOOT_WORKER_STACK_SIZE
+#define MBED_CONF_APP_BOOT_WORKER_STACK_SIZE 4096
+#endif
+
+// Most stages a boot sequence can hold. Stages are numbered in the order they are added, and their
+// dependencies are given as a bit mask of those numbers
+#define BOOT_MAX_STAGES 16
+
+// One step of the boot and the stages that must finish before it starts
+struct BootStage {
+    const char *name;
+    Callback<void()> func;
+    uint32_t dependsOn;
+
+    bool started;
+    bool done;
+    Kernel::Clock::time_point startedAt;
+    Kernel::Clock::time_point doneAt;
+};
+
+// Runs the boot stages as soon as their dependencies are done, several at a time, so slow stages like the
+// Wi-Fi association don't hold up stages that don't need them. Each stage is timed, so the boot time can
+// be broken down afterwards
+class BootSequence {
+public:
+    BootSequence();
+
+    // Adds a stage. Returns its bit, to be used in the dependencies of later stages
+    uint32_t add(const char *name, Callback<void()> func, uint32_t dependsOn = 0);
+
+    // Runs all stages on the main thread and the boot workers. Returns once every stage is done
+    void run();
+
+    // Prints when each stage started and how long it took, relative to the start of run()
+    void printTimes() const;
+
+private:
+    void work();
+    int next() const;
+
+    BootStage _stages[BOOT_MAX_STAGES];
+    int _count;
+    uint32_t _doneMask;
+    Kernel::Clock::time_point _startedAt;
+    Kernel::Clock::time_point _doneAt;
+
+    Mutex _mutex;
+    ConditionVariable _changed;
+};
+
+#endif // SMARTWATCH_BOOT_SEQUENCE_H
@@ -0,0 +1,83 @@
+/**
+ * @file   clockDiscipline.h
+ * @author Tobias Kallevik
+*/
+
+#ifndef SMARTWATCH_CLOCK_DISCIPLINE_H
+#define SMARTWATCH_CLOCK_DISCIPLINE_H
+
+// Includes
+#include "mbed.h"
+#include <chrono>
+#include <cstdint>
+
+using namespace std::chrono;
+
+// Largest clock error in ms allowed between two syncs. Set in mbed_app.json
+#ifndef MBED_CONF_APP_CLOCK_MAX_ERROR_MS
+#define MBED_CONF_APP_CLOCK_MAX_ERROR_MS 1000
+#endif
+
+// Shortest and longest time in seconds between two syncs
+#ifndef MBED_CONF_APP_CLOCK_MIN_SYNC_INTERVAL
+#define MBED_CONF_APP_CLOCK_MIN_SYNC_INTERVAL 900
+#endif
+
+#ifndef MBED_CONF_APP_CLOCK_MAX_SYNC_INTERVAL
+#define MBED_CONF_APP_CLOCK_MAX_SYNC_INTERVAL 86400
+#endif
+
+// Smallest rate uncertainty assumed, so one lucky sync doesn't stretch the interval to the max. In parts per million
+#define CLOCK_RATE_FLOOR_PPM 2.0
+
+// Weight of a new rate measurement against the estimate
+#define CLOCK_RATE_GAIN 0.3
+
+// Learns how fast the RTC runs compared to real time, corrects the time shown for it, and picks the time
+// until the next sync so the error stays below the max.
+//
+// At each precise sync the error the RTC has built up since the last one gives its rate error. Between
+// syncs the expected error (rate times time since the sync) is added to the time shown. How far the rate
+// measurements spread tells how well the rate is known, and so how long the clock can go without a sync.
+// Time since the sync is taken from the kernel clock, which has ms resolution where the RTC has seconds.
+// Both run from the same 32 kHz crystal on this board, so they drift together
+class ClockDiscipline {
+public:
+    ClockDiscipline();
+
+    // A precise sync (SNTP). trueUs is the real local time in microseconds right now. Measures the rate and
+    // starts the next interval from here. The RTC must be set to trueUs by the caller
+    void observe(int64_t trueUs);
+
+    // The RTC was set from a source only good to a second (the time API). Starts the next interval from
+    // here, but the error built up since the last sync isn't measured since it can't be told from the source error
+    void stepped(int64_t trueUs);
+
+    // Microseconds to add to the RTC to get the real time
+    int64_t correctionUs() const;
+
+    // Seconds until the next sync is needed
+    int syncInterval() const;
+
+    // Estimated rate error in parts per million. Positive when the RTC runs slow
+    double ratePpm() const;
+
+private:
+    int64_t sinceSyncUs() const;
+
+    bool _synced;
+    bool _preciseBase;
+    int _measurements;
+
+    // Real time at the last sync, and the kernel time it happened at
+    int64_t _baseUs;
+    Kernel::Clock::time_point _syncedAt;
+
+    // Rate error as a fraction, and how much the measurements spread around it
+    double _rate;
+    double _rateSpread;
+
+    mutable Mutex _mutex;
+};
+
+#endif // SMARTWATCH_CLOCK_DISCIPLINE_H
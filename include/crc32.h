@@ -0,0 +1,17 @@
+/**
+ * @file   crc32.h
+ * @author Tobias Kallevik
+*/
+
+#ifndef SMARTWATCH_CRC32_H
+#define SMARTWATCH_CRC32_H
+
+// Includes
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32 (IEEE), as used by gzip. A buffer received in parts is checked by passing the CRC of the
+// parts so far as crc, starting from 0
+uint32_t crc32(const void *data, size_t length, uint32_t crc = 0);
+
+#endif // SMARTWATCH_CRC32_H
@@ -0,0 +1,115 @@
+/**
+ * @file   displayService.h
+ * @author Tobias Kallevik
+*/
+
+#ifndef SMARTWATCH_DISPLAY_SERVICE_H
+#define SMARTWATCH_DISPLAY_SERVICE_H
+
+// Includes
+#include "mbed.h"
+#include "DFRobot_RGBLCD.h"
+#include "snapshot.h"
+#include <chrono>
+#include <cstdint>
+
+using namespace std::chrono;
+
+// Stack of the display thread. It only runs the LCD driver. Set in mbed_app.json
+#ifndef MBED_CONF_APP_DISPLAY_THREAD_STACK_SIZE
+#define MBED_CONF_APP_DISPLAY_THREAD_STACK_SIZE 1024
+#endif
+
+// Time in ms between two steps of the ticker. Set in mbed_app.json
+#ifndef MBED_CONF_APP_TICKER_STEP_TIME
+#define MBED_CONF_APP_TICKER_STEP_TIME 250
+#endif
+
+// Longest text the ticker runs, with its ending null. Fits the RSS feed, three 160 byte titles with 16 spaces around each. Set in mbed_app.json
+#ifndef MBED_CONF_APP_TICKER_SIZE
+#define MBED_CONF_APP_TICKER_SIZE 576
+#endif
+
+// Thread flag set when a new frame has been submitted
+#define DISPLAY_FRAME_FLAG 0x1
+
+// The characters of one complete screen, and the ticker running on it if there is one
+struct LcdFrame {
+    char text[LCD_MAX_ROWS][LCD_MAX_COLS];
+    uint8_t tickerRow;
+    char ticker[MBED_CONF_APP_TICKER_SIZE];
+};
+
+class DisplayService;
+
+// What the screens draw on. Has the drawing calls of the LCD driver, but only changes its own frame, so
+// drawing never touches the bus. submit() hands the frame to the display thread
+class LcdCanvas {
+public:
+    LcdCanvas(DisplayService *display);
+
+    void clear();
+    void home();
+    void setCursor(uint8_t col, uint8_t row);
+    void write(char value);
+    void printf(const char *format, ...);
+
+    // Runs the text through the row, one column per step, starting over when it ends. The display thread
+    // steps it by shifting the LCD, which moves the other rows too, so they scroll around with it. Drawing
+    // the same ticker again leaves it running, and clearing the canvas stops it
+    void ticker(uint8_t row, const char *text);
+
+    // Sends the frame as it is now. Drawing can carry on right away
+    void submit();
+
+private:
+    DisplayService *_display;
+    LcdFrame _frame;
+    uint8_t _cols;
+    uint8_t _rows;
+    uint8_t _col;
+    uint8_t _row;
+};
+
+// Owns the LCD and sends it the frames the screens submit, on a thread of its own. Submitting only
+// copies the frame, so the main loop never waits for the bus. If frames are submitted faster than the
+// LCD takes them, only the latest is sent and the ones in between are dropped. The thread also steps
+// the ticker of the frame shown, so a scrolling screen only has to be submitted once
+class DisplayService {
+public:
+    DisplayService(uint8_t cols, uint8_t rows, PinName sda, PinName scl);
+
+    // Starts the thread, which sets up the LCD before sending the first frame
+    void start(bool conservativeTiming);
+
+    // Used by the canvas. Replaces the frame waiting to be sent, if there is one
+    void submit(const LcdFrame &frame);
+
+    uint8_t cols() const { return _cols; }
+    uint8_t rows() const { return _rows; }
+
+    // Frames replaced by a newer one before they were sent
+    uint32_t dropped() const { return _dropped; }
+
+private:
+    void run();
+    void show(bool sameTicker);
+
+    DFRobot_RGBLCD _lcd;
+    uint8_t _cols;
+    uint8_t _rows;
+
+    // Written by the screens and read by the display thread, which never blocks either side
+    Snapshot<LcdFrame> _frames;
+    uint32_t _dropped;
+
+    // The frame shown, which the ticker reads its text from, and the latest frame read. Kept here since
+    // they are too big for the stack of the display thread
+    LcdFrame _shown;
+    LcdFrame _next;
+    Kernel::Clock::time_point _nextStep;
+
+    Thread _thread;
+};
+
+#endif // SMARTWATCH_DISPLAY_SERVICE_H
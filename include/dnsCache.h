@@ -0,0 +1,73 @@
+/**
+ * @file   dnsCache.h
+ * @author Tobias Kallevik
+*/
+
+#ifndef SMARTWATCH_DNS_CACHE_H
+#define SMARTWATCH_DNS_CACHE_H
+
+// Includes
+#include "mbed.h"
+#include <chrono>
+
+using namespace std::chrono;
+
+// Seconds an address is used before it is looked up again. Set in mbed_app.json
+#ifndef MBED_CONF_APP_DNS_CACHE_TTL
+#define MBED_CONF_APP_DNS_CACHE_TTL 600
+#endif
+
+// Seconds a failed lookup is remembered, so a missing host isn't looked up on every fetch
+#ifndef MBED_CONF_APP_DNS_NEGATIVE_TTL
+#define MBED_CONF_APP_DNS_NEGATIVE_TTL 30
+#endif
+
+// Seconds before expiry when a lookup is started in the background while the cached address is still used
+#ifndef MBED_CONF_APP_DNS_REFRESH_AHEAD
+#define MBED_CONF_APP_DNS_REFRESH_AHEAD 120
+#endif
+
+// Number of hosts kept. The least recently used host is replaced when full
+#define DNS_CACHE_SIZE 4
+
+// Longest host name kept, including the terminating null
+#define DNS_HOST_SIZE 48
+
+// One cached lookup. A failed lookup keeps its error instead of an address
+struct DnsEntry {
+    char host[DNS_HOST_SIZE];
+    SocketAddress address;
+    nsapi_error_t error = NSAPI_ERROR_OK;
+    Kernel::Clock::time_point expires;
+    Kernel::Clock::time_point lastUsed;
+    bool used = false;
+};
+
+// Host name cache shared by everything that connects to the network
+class DnsCache {
+public:
+    void setNetwork(NetworkInterface *network);
+
+    // Gives the address of the host. Only looks it up if there is no valid cached answer
+    nsapi_error_t resolve(const char *host, SocketAddress *address);
+
+    // Forgets the host, for example when connecting to the cached address failed
+    void invalidate(const char *host);
+
+private:
+    DnsEntry *find(const char *host);
+    void store(const char *host, nsapi_error_t error, const SocketAddress *address);
+    void startRefresh(const char *host);
+    void refreshDone(nsapi_error_t result, SocketAddress *address);
+
+    NetworkInterface *_network = nullptr;
+    DnsEntry _entries[DNS_CACHE_SIZE];
+
+    // Host of the background lookup in progress. Only one runs at a time
+    char _refreshHost[DNS_HOST_SIZE];
+    bool _refreshing = false;
+
+    Mutex _mutex;
+};
+
+#endif // SMARTWATCH_DNS_CACHE_H
@@ -0,0 +1,70 @@
+/**
+ * @file   fetchQueue.h
+ * @author Tobias Kallevik
+*/
+
+#ifndef SMARTWATCH_FETCH_QUEUE_H
+#define SMARTWATCH_FETCH_QUEUE_H
+
+// Includes
+#include "mbed.h"
+#include <cstdint>
+
+// The data the network thread can fetch
+enum FetchJob {
+    FetchTime,
+    FetchClock,
+    FetchWeather,
+    FetchRss,
+    FetchJobCount
+};
+
+// Fetches for the screen the user is looking at run before background polling
+enum FetchPriority {
+    PriorityBackground,
+    PriorityUser
+};
+
+// Jobs waiting for the network thread. Each job is queued at most once, so asking for a job that is
+// already waiting only raises its priority. A job that is running is queued again, since it may have
+// started before the data it depends on (like the city) was changed
+class FetchQueue {
+public:
+    FetchQueue();
+
+    // Queues the job. Returns false if it was already waiting
+    bool request(FetchJob job, FetchPriority priority);
+
+    // Queues the job and blocks until it has run. Returns true if the fetch succeeded
+    bool requestAndWait(FetchJob job, FetchPriority priority);
+
+    // Used by the network thread. Blocks until a job is waiting and takes the most urgent one
+    FetchJob take();
+
+    // Used by the network thread when the job taken last has run
+    void finish(FetchJob job, bool succeeded);
+
+    // Used by the network thread instead of finish when the job taken last couldn't run. Puts it back
+    // first in line for its priority, and anyone waiting for it keeps waiting
+    void retry(FetchJob job);
+
+private:
+    uint32_t queue(FetchJob job, FetchPriority priority, bool *added);
+
+    // Waiting jobs. The order keeps jobs of the same priority first come, first served
+    bool _queued[FetchJobCount];
+    FetchPriority _priority[FetchJobCount];
+    uint32_t _order[FetchJobCount];
+
+    // Ticket of the waiting run and of the last finished run of each job, used to wait for a specific run
+    uint32_t _queuedTicket[FetchJobCount];
+    uint32_t _runningTicket[FetchJobCount];
+    uint32_t _finishedTicket[FetchJobCount];
+    bool _succeeded[FetchJobCount];
+    uint32_t _nextTicket;
+
+    Mutex _mutex;
+    ConditionVariable _changed;
+};
+
+#endif // SMARTWATCH_FETCH_QUEUE_H
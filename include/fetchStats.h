@@ -0,0 +1,63 @@
+/**
+ * @file   fetchStats.h
+ * @author Tobias Kallevik
+*/
+
+#ifndef SMARTWATCH_FETCH_STATS_H
+#define SMARTWATCH_FETCH_STATS_H
+
+// Includes
+#include "mbed.h"
+#include <cstdint>
+#include "fetchQueue.h"
+#include "requestTiming.h"
+
+// Number of recent requests kept, over all endpoints
+#define FETCH_STATS_SIZE 32
+
+// A summary is printed on the serial console after this many requests
+#define FETCH_STATS_PRINT_EVERY 16
+
+// One request made by the network thread
+struct FetchRecord {
+    FetchJob job;
+    bool succeeded;
+    RequestTiming timing;
+};
+
+// Percentiles of the recent requests to one endpoint
+struct FetchSummary {
+    int count;
+    int failures;
+    int32_t p50[TimingPhaseCount];
+    int32_t p95[TimingPhaseCount];
+};
+
+// Short names of the endpoints and phases, for printing
+extern const char *const fetchJobNames[FetchJobCount];
+extern const char *const timingPhaseNames[TimingPhaseCount];
+
+// Ring of the most recent requests, so it can be seen where the time of a slow refresh goes. Written by
+// the network thread and read by the diagnostics screen
+class FetchStats {
+public:
+    FetchStats();
+
+    // Adds a request, dropping the oldest once the ring is full, and prints its breakdown. A request
+    // failed if it got a network error or an HTTP error status
+    void record(FetchJob job, const RequestTiming &timing);
+
+    // Summarizes the recent requests to the endpoint. Returns false if there are none
+    bool summary(FetchJob job, FetchSummary *summary) const;
+
+    // Prints the summary of every endpoint
+    void print() const;
+
+private:
+    FetchRecord _records[FETCH_STATS_SIZE];
+    uint32_t _count;
+
+    mutable Mutex _mutex;
+};
+
+#endif // SMARTWATCH_FETCH_STATS_H
@@ -0,0 +1,112 @@
+/**
+ * @file   httpClient.h
+ * @author Tobias Kallevik
+*/
+
+#ifndef SMARTWATCH_HTTP_CLIENT_H
+#define SMARTWATCH_HTTP_CLIENT_H
+
+// Includes
+#include "mbed.h"
+#include <string>
+#include <vector>
+#include <chrono>
+#include "tlsContext.h"
+#include "dnsCache.h"
+#include "httpResponseParser.h"
+#include "requestTiming.h"
+
+using namespace std::chrono;
+
+// Number of hosts the connection pool can keep open at the same time (time, weather and RSS)
+#define HTTP_POOL_SIZE 3
+
+// Socket timeout in ms used for all pooled connections
+#define HTTP_SOCKET_TIMEOUT 5000
+
+// Builds a HTTP/1.1 request. The Host header is always added and keep-alive is the default in HTTP/1.1
+class HttpRequest {
+public:
+    HttpRequest(const char *method, const char *host, const string &path);
+
+    void addHeader(const char *name, const string &value);
+    string build() const;
+
+    const char *host() const { return _host; }
+    const string &path() const { return _path; }
+
+private:
+    const char *_method;
+    const char *_host;
+    string _path;
+    vector<pair<const char *, string>> _headers;
+};
+
+// Validators from the last response for a resource. Sending them back lets the server answer 304 Not Modified
+// with no body when nothing has changed. They are tied to the path, so a new query (like another city) starts over
+struct HttpValidators {
+    string path;
+    string etag;
+    string lastModified;
+
+    // Adds If-None-Match and If-Modified-Since to the request if there are validators for its path
+    void apply(HttpRequest *request) const;
+
+    // Keeps the validators of a 200 response. Only call this once the response has been used, so a
+    // response that failed to parse is fetched again in full next time
+    void store(const HttpRequest &request, const HttpResponse &response);
+};
+
+// One pooled connection to a host
+struct HttpConnection {
+    const char *host = nullptr;
+    uint16_t port = 0;
+    TCPSocket *socket = nullptr;
+    TlsStream *tls = nullptr;
+    bool inUse = false;
+    Kernel::Clock::time_point expires;
+};
+
+// HTTP client keeping one connection per host open between requests when the server allows it
+class HttpClient {
+public:
+    HttpClient();
+    ~HttpClient();
+
+    // Sets the network used when opening new connections and the cache used to look up hosts
+    void setNetwork(NetworkInterface *network, DnsCache *dns);
+
+    // Sends the request to the host and reads the response. Uses TLS when a TLS context is given
+    // The body is passed to the handler if one is given, otherwise it is stored in response->body
+    // If timing is given, it is filled with where the time of the request went
+    nsapi_error_t send(const HttpRequest &request, uint16_t port, HttpResponse *response,
+                       TlsContext *tls = nullptr, HttpBodyHandler handler = nullptr, void *context = nullptr,
+                       RequestTiming *timing = nullptr);
+
+    // Closes all pooled connections
+    void closeAll();
+
+private:
+    HttpConnection *acquire(const char *host, uint16_t port, TlsContext *tls, bool *reused, nsapi_error_t *error, RequestTiming *timing);
+    void release(HttpConnection *connection, bool reusable);
+    void closeConnection(HttpConnection *connection);
+    nsapi_error_t openConnection(HttpConnection *connection, const char *host, uint16_t port, TlsContext *tls, RequestTiming *timing);
+
+    // Sends and receives through TLS if the connection uses it, otherwise directly on the socket
+    nsapi_size_or_error_t transportSend(HttpConnection *connection, const void *data, nsapi_size_t length);
+    nsapi_size_or_error_t transportRecv(HttpConnection *connection, void *data, nsapi_size_t length);
+
+    nsapi_error_t sendAll(HttpConnection *connection, const char *data, size_t length);
+    nsapi_error_t readResponse(HttpConnection *connection, HttpResponse *response, HttpBodyHandler handler, void *context, bool *complete, RequestTiming *timing);
+
+    NetworkInterface *_network = nullptr;
+    DnsCache *_dns = nullptr;
+    HttpConnection _pool[HTTP_POOL_SIZE];
+    Mutex _mutex;
+
+    // Every response is received into this ring and parsed in place, whatever the size of the body. Only
+    // the network thread sends requests, so one ring is enough
+    RecvRing _ring;
+};
+
+#endif // SMARTWATCH_HTTP_CLIENT_H
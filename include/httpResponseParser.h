@@ -0,0 +1,110 @@
+/**
+ * @file   httpResponseParser.h
+ * @author Tobias Kallevik
+*/
+
+#ifndef SMARTWATCH_HTTP_RESPONSE_PARSER_H
+#define SMARTWATCH_HTTP_RESPONSE_PARSER_H
+
+// Includes
+#include <cstddef>
+#include <string>
+#include "recvRing.h"
+
+// Idle time in seconds a connection is kept when the server doesn't send a Keep-Alive timeout
+#define HTTP_DEFAULT_KEEP_ALIVE 60
+
+// Longest status or header line kept. The rest of a longer line is skipped. Lines shorter than this are
+// parsed in place in the receive ring
+#define HTTP_LINE_SIZE 256
+
+// Largest response header accepted before the response is treated as broken
+#define HTTP_MAX_HEADER_SIZE 2048
+
+// Called with each part of the response body as it arrives. Returning false stops the transfer
+typedef bool (*HttpBodyHandler)(void *context, const char *data, size_t length);
+
+// Response status and the headers needed by the client
+struct HttpResponse {
+    int status = 0;
+    bool keepAlive = true;
+    int keepAliveTimeout = HTTP_DEFAULT_KEEP_ALIVE;
+    bool hasContentLength = false;
+    size_t contentLength = 0;
+    bool chunked = false;
+    size_t bodyLength = 0;
+
+    // The body is gzip compressed (Content-Encoding: gzip) and must be decoded by the body handler
+    bool gzip = false;
+
+    // Validators the server sent for the resource, used to ask for it again only if it changed
+    std::string etag;
+    std::string lastModified;
+
+    // Holds the body when no body handler is given
+    std::string body;
+};
+
+// Reads a HTTP/1.1 response as it arrives in a receive ring. The body is passed on to the handler
+// straight from the ring as soon as it is received, decoded if it is chunked. Header lines are parsed
+// where they lie in the ring, and only copied out if they wrap around its end or are too long.
+// The response is complete after Content-Length bytes or the last chunk, without waiting for the
+// server to close. Without either, the body lasts until the connection closes
+class HttpResponseParser {
+public:
+    HttpResponseParser(HttpResponse *response, HttpBodyHandler handler, void *context);
+
+    // Parses the bytes received into the ring and consumes them. The start of a line may be left in the
+    // ring until the rest of it arrives. Returns false once no more bytes are wanted, that is when the
+    // response is complete, broken or stopped by the handler
+    bool feed(RecvRing *ring);
+
+    // Tells the parser the connection was closed. Returns true if that completed the response
+    bool closed();
+
+    bool headerDone() const { return _state > Header; }
+    bool done() const { return _state == Done; }
+    bool failed() const { return _state == Failed; }
+    bool stopped() const { return _state == Stopped; }
+
+    // True when the body only ends when the connection closes
+    bool readsUntilClose() const { return _state == BodyUntilClose; }
+
+private:
+    enum State {
+        StatusLine,
+        Header,
+        Body,
+        BodyUntilClose,
+        ChunkSize,
+        ChunkData,
+        ChunkDataEnd,
+        Trailer,
+        Done,
+        Failed,
+        Stopped
+    };
+
+    bool line(RecvRing *ring);
+    void appendLine(const char *data, size_t length);
+    void statusLine(const char *line);
+    void headerLine(const char *line, size_t length);
+    void endHeader();
+    void chunkSizeLine(const char *line);
+    void trailerLine(size_t length);
+    void body(const char *data, size_t length);
+
+    HttpResponse *_response;
+    HttpBodyHandler _handler;
+    void *_context;
+
+    State _state;
+    size_t _headerSize;
+    size_t _remaining;
+
+    // Start of a line that wrapped around the end of the ring or was too long to wait for
+    char _line[HTTP_LINE_SIZE];
+    size_t _lineLength;
+};
+
+#endif // SMARTWATCH_HTTP_RESPONSE_PARSER_H
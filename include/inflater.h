@@ -0,0 +1,163 @@
+/**
+ * @file   inflater.h
+ * @author Tobias Kallevik
+*/
+
+#ifndef SMARTWATCH_INFLATER_H
+#define SMARTWATCH_INFLATER_H
+
+// Includes
+#include <cstddef>
+#include <cstdint>
+#include "httpResponseParser.h"
+
+// Window a deflate stream may refer back into. Servers use the largest the format allows
+#define INFLATE_WINDOW_SIZE 32768
+
+// Longest Huffman code in a deflate stream
+#define INFLATE_MAX_BITS 15
+
+// Symbols in the literal/length and distance alphabets, with room for the two unused ones of each
+#define INFLATE_LIT_CODES 288
+#define INFLATE_DIST_CODES 32
+
+enum InflateResult {
+    // All input was used and more is needed
+    InflateMore,
+    // The end of the stream was reached
+    InflateDone,
+    // The output handler stopped the stream
+    InflateStopped,
+    // The stream is broken
+    InflateError
+};
+
+// Decodes a raw deflate stream (RFC 1951) as it arrives, in parts of any size. The output is passed on
+// to the handler as it's decoded, straight from the window, so nothing but the window is buffered.
+// The window is taken from the heap by init() and given back when the inflater is destroyed, so it's
+// only held while a compressed response is read
+class Inflater {
+public:
+    Inflater();
+    ~Inflater();
+
+    // Takes the window and starts a new stream. Returns false if there isn't memory for it
+    bool init();
+
+    // Decodes the next part of the stream. used is set to the bytes taken from data, which is all of
+    // them unless the stream ended or stopped
+    InflateResult feed(const uint8_t *data, size_t length, size_t *used, HttpBodyHandler handler, void *context);
+
+    // Bytes after the end of the stream that were read ahead. At most 8. Used to find the data that follows
+    size_t leftover(uint8_t *bytes);
+
+private:
+    enum State {
+        BlockHeader,
+        StoredLength,
+        Stored,
+        TableSizes,
+        CodeLengthCodes,
+        CodeLengths,
+        Codes,
+        Distance,
+        Copy,
+        Done,
+        Stopped,
+        Failed
+    };
+
+    InflateResult run();
+    bool need(int count);
+    uint32_t take(int count);
+    int decode(const uint16_t *counts, const uint16_t *symbols, int *length);
+    bool put(uint8_t byte);
+    bool flush();
+    void fixedTables();
+
+    uint8_t *_window;
+    uint32_t _position;
+    uint32_t _flushed;
+
+    State _state;
+    bool _final;
+
+    // Bits read from the input but not used yet, the first in the lowest bit
+    uint64_t _bits;
+    int _bitCount;
+
+    // Input and output of the current feed call
+    const uint8_t *_in;
+    const uint8_t *_inEnd;
+    HttpBodyHandler _handler;
+    void *_context;
+
+    // Huffman tables of the current block. The distance table holds the code length code while the
+    // code lengths of a dynamic block are read
+    uint16_t _litCounts[INFLATE_MAX_BITS + 1];
+    uint16_t _litSymbols[INFLATE_LIT_CODES];
+    uint16_t _distCounts[INFLATE_MAX_BITS + 1];
+    uint16_t _distSymbols[INFLATE_DIST_CODES];
+
+    // Code lengths of a dynamic block while they are read
+    uint8_t _lengths[INFLATE_LIT_CODES + INFLATE_DIST_CODES];
+    int _litCount;
+    int _distCount;
+    int _codeLengthCount;
+    int _index;
+
+    // Stored bytes left, or the length and distance of the match being copied
+    uint32_t _remaining;
+    uint32_t _length;
+    uint32_t _distance;
+};
+
+// Unwraps a gzip stream (RFC 1952) around the inflater. The header is skipped, and the CRC and size in
+// the trailer are checked against the output
+class GzipDecoder {
+public:
+    GzipDecoder(HttpBodyHandler handler, void *context);
+
+    // Takes the window. Returns false if there isn't memory for it, so gzip shouldn't be asked for
+    bool init() { return _inflater.init(); }
+
+    // Decodes the next part of the stream. Returns false once no more is wanted, because the stream is
+    // broken or the handler stopped it
+    bool feed(const char *data, size_t length);
+
+    bool done() const { return _state == Done; }
+    bool failed() const { return _state == Failed; }
+
+private:
+    enum State {
+        Header,
+        ExtraLength,
+        Extra,
+        Name,
+        Comment,
+        HeaderCrc,
+        Body,
+        Trailer,
+        Done,
+        Stopped,
+        Failed
+    };
+
+    bool headerByte(uint8_t byte);
+    void nextField();
+    static bool output(void *context, const char *data, size_t length);
+
+    Inflater _inflater;
+    HttpBodyHandler _handler;
+    void *_context;
+
+    State _state;
+    uint8_t _flags;
+    uint32_t _count;
+    uint32_t _extraLength;
+    uint8_t _trailer[8];
+    uint32_t _crc;
+    uint32_t _size;
+};
+
+#endif // SMARTWATCH_INFLATER_H
@@ -0,0 +1,103 @@
+/**
+ * @file   jsonExtractor.h
+ * @author Tobias Kallevik
+*/
+
+#ifndef SMARTWATCH_JSON_EXTRACTOR_H
+#define SMARTWATCH_JSON_EXTRACTOR_H
+
+// Includes
+#include <cstddef>
+#include <cstdint>
+
+// Longest value kept for a wanted field, including the terminating null
+#define JSON_VALUE_SIZE 48
+
+// Longest dotted path tracked, for example "current.condition.text"
+#define JSON_PATH_SIZE 64
+
+// Nesting levels that get a path. Deeper levels are parsed but never matched
+#define JSON_MAX_PATH_DEPTH 8
+
+// Nesting levels accepted before the document is treated as broken
+#define JSON_MAX_DEPTH 32
+
+// A value wanted from the document. The path uses dots between object keys and [] for array elements
+struct JsonField {
+    JsonField(const char *path) : path(path), value(), found(false) {}
+
+    const char *path;
+    char value[JSON_VALUE_SIZE];
+    bool found;
+};
+
+// Extracts the wanted fields from a JSON document as it arrives, without building the whole
+// document in memory. Strings are stored unescaped and without quotes, other values as written
+class JsonExtractor {
+public:
+    JsonExtractor(JsonField *fields, size_t fieldCount);
+
+    // Forgets all state and found values so a new document can be parsed
+    void reset();
+
+    // Parses the next part of the document. Returns false if the document is broken
+    bool feed(const char *data, size_t length);
+
+    // True when the top level object or array has been closed
+    bool done() const { return _state == Done; }
+    bool failed() const { return _state == Failed; }
+
+    // True when every wanted field was in the document
+    bool foundAll() const;
+
+    // Returns the value for a path, or nullptr if it wasn't in the document
+    const char *value(const char *path) const;
+
+private:
+    enum State {
+        WaitForDocument,
+        KeyOrEnd,
+        Key,
+        Colon,
+        ValueOrEnd,
+        Value,
+        String,
+        Escape,
+        Unicode,
+        Literal,
+        AfterValue,
+        Done,
+        Failed
+    };
+
+    void step(char c);
+    void stringChar(char c);
+    void beginValue();
+    void endValue();
+    void push(bool object);
+    void pop(char c);
+    void beginSegment();
+    void appendPath(char c);
+    bool inObject() const { return (_objectBits >> (_depth - 1)) & 1; }
+
+    JsonField *_fields;
+    size_t _fieldCount;
+
+    State _state;
+    bool _readingKey;
+    int _depth;
+    uint32_t _objectBits;
+
+    char _path[JSON_PATH_SIZE];
+    size_t _pathLength;
+    bool _pathOverflow;
+    size_t _segmentStart[JSON_MAX_PATH_DEPTH + 1];
+    bool _segmentOverflow[JSON_MAX_PATH_DEPTH + 1];
+
+    JsonField *_capture;
+    size_t _captureLength;
+    uint16_t _unicode;
+    int _unicodeDigits;
+};
+
+#endif // SMARTWATCH_JSON_EXTRACTOR_H
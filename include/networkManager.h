@@ -0,0 +1,74 @@
+/**
+ * @file   networkManager.h
+ * @author Tobias Kallevik
+*/
+
+#ifndef SMARTWATCH_NETWORK_MANAGER_H
+#define SMARTWATCH_NETWORK_MANAGER_H
+
+// Includes
+#include "mbed.h"
+#include <chrono>
+#include <cstdint>
+#include "backoff.h"
+
+using namespace std::chrono;
+
+// Wait in ms after the first failed attempt to connect to the network, and the longest wait between attempts
+#define NETWORK_RETRY_BASE_MS 1000
+#define NETWORK_RETRY_MAX_MS 30000
+
+// Failed fetches in a row, over all endpoints, before the link is taken to be down even though the
+// module hasn't said so. Set in mbed_app.json
+#ifndef MBED_CONF_APP_LINK_FAILURE_THRESHOLD
+#define MBED_CONF_APP_LINK_FAILURE_THRESHOLD 3
+#endif
+
+// Keeps the Wi-Fi link up for the network thread. The module reports status changes through a callback.
+// When the link drops, the next fetch waits here while the module rejoins, so queued fetches are held
+// instead of failing one by one against a dead link.
+//
+// A rejoin disconnects the interface already set up, unless the module already reports it disconnected,
+// and then connects it again. The module still reports itself associated when the drop was assumed from
+// failed fetches, and only a disconnect makes it associate again. The default interface isn't looked up
+// again, the credentials stay in the module, and the DNS cache and TLS session are kept
+class NetworkManager {
+public:
+    NetworkManager();
+
+    // Takes the interface to manage and listens for its status changes
+    void init(NetworkInterface *network);
+
+    // Connects, retrying with backoff until it succeeds. Used at boot
+    void connect();
+
+    // Blocks until the link is up, rejoining if it went down. Returns true if it had to rejoin
+    bool waitUntilUp();
+
+    // True while the link is up as far as is known. Always true before init, since there is nothing to rejoin
+    bool up() const;
+
+    // Tells the manager how a fetch went. Fetches that keep failing with link errors on all endpoints mean
+    // the link is down. Any answer from a server, even an error, shows the link works
+    void fetchDone(nsapi_error_t result);
+
+    // True for the errors of DNS, connecting and the socket, which the link may be to blame for. Errors
+    // in what the server sent are the server's
+    static bool linkError(nsapi_error_t result);
+
+    // Times the link has dropped since boot
+    uint32_t drops() const;
+
+private:
+    void statusChanged(nsapi_event_t event, intptr_t value);
+    void setUp(bool up);
+
+    NetworkInterface *_network;
+    volatile bool _up;
+    volatile uint32_t _drops;
+
+    // Fetches in a row that failed with a link error. Only used by the network thread
+    int _failures;
+};
+
+#endif // SMARTWATCH_NETWORK_MANAGER_H
@@ -0,0 +1,68 @@
+/**
+ * @file   persistentStore.h
+ * @author Tobias Kallevik
+*/
+
+#ifndef SMARTWATCH_PERSISTENT_STORE_H
+#define SMARTWATCH_PERSISTENT_STORE_H
+
+// Includes
+#include "mbed.h"
+#include <chrono>
+#include <cstdint>
+#include "crc32.h"
+
+using namespace std::chrono;
+
+// Shortest time in seconds between two writes, to spare the flash. Set in mbed_app.json
+#ifndef MBED_CONF_APP_PERSIST_MIN_INTERVAL
+#define MBED_CONF_APP_PERSIST_MIN_INTERVAL 1800
+#endif
+
+// Largest record that can be stored, without the header
+#define PERSIST_MAX_SIZE 1024
+
+// Largest flash program page the store works with. The STM32L4 programs 8 bytes at a time
+#define PERSIST_MAX_PAGE_SIZE 8
+
+// Marks a sector holding a record ("SWC1")
+#define PERSIST_MAGIC 0x53574331
+
+// Header written before the record. The record is only used if the magic, version, length and CRC all match
+struct PersistHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t length;
+    uint32_t crc;
+    uint32_t reserved;
+};
+
+// Keeps one record in the last sector of the internal flash, so it survives a reset or power loss.
+// The caller bumps the version whenever the layout of the record changes, so an old record is never
+// read into a new layout
+class PersistentStore {
+public:
+    PersistentStore();
+
+    // Reads the record. Returns false if there is none or it doesn't match the size and version
+    bool load(void *data, uint16_t size, uint16_t version);
+
+    // Writes the record if it changed and the last write was long enough ago. Returns true if it was written
+    bool save(const void *data, uint16_t size, uint16_t version);
+
+private:
+    bool open();
+
+    FlashIAP _flash;
+    bool _open;
+    uint32_t _address;
+    uint32_t _sectorSize;
+    uint32_t _pageSize;
+
+    // CRC and time of the last record written or read, to skip writes that change nothing
+    bool _haveSaved;
+    uint32_t _savedCrc;
+    Kernel::Clock::time_point _savedAt;
+};
+
+#endif // SMARTWATCH_PERSISTENT_STORE_H
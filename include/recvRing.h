@@ -0,0 +1,56 @@
+/**
+ * @file   recvRing.h
+ * @author Tobias Kallevik
+*/
+
+#ifndef SMARTWATCH_RECV_RING_H
+#define SMARTWATCH_RECV_RING_H
+
+// Includes
+#include <cstddef>
+#include <cstdint>
+
+// Size of the ring responses are received into. Must be a power of two, and larger than the longest line
+// a parser waits for
+#define RECV_RING_SIZE 1024
+
+// Bytes in a buffer owned by someone else
+struct ByteSpan {
+    char *data;
+    size_t length;
+};
+
+// Fixed buffer that received data is written into and parsed from in place. Bytes a parser can't use yet,
+// like the start of a line, stay in the ring until the rest arrives, so they are never copied out.
+// The data may wrap around the end of the buffer, so both sides work on contiguous spans: the receiver
+// fills the free span at the back and the parser reads the span at the front
+class RecvRing {
+public:
+    RecvRing() : _read(0), _write(0) {}
+
+    // Contiguous free space to receive into. Empty when the ring is full
+    ByteSpan space();
+
+    // Adds the bytes just written into the free span
+    void commit(size_t length);
+
+    // Contiguous bytes at the front. Shorter than size() when the data wraps around the end. Parsers may
+    // change the bytes, for example to end a line in place
+    ByteSpan front();
+
+    // Drops bytes from the front once they have been used
+    void consume(size_t length);
+
+    size_t size() const { return _write - _read; }
+    bool full() const { return size() == RECV_RING_SIZE; }
+    void clear() { _read = _write = 0; }
+
+private:
+    char _buffer[RECV_RING_SIZE];
+
+    // Positions only grow and are wrapped when used, so a full ring can be told from an empty one
+    uint32_t _read;
+    uint32_t _write;
+};
+
+#endif // SMARTWATCH_RECV_RING_H
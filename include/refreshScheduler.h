@@ -0,0 +1,72 @@
+/**
+ * @file   refreshScheduler.h
+ * @author Tobias Kallevik
+*/
+
+#ifndef SMARTWATCH_REFRESH_SCHEDULER_H
+#define SMARTWATCH_REFRESH_SCHEDULER_H
+
+// Includes
+#include "mbed.h"
+#include <chrono>
+#include "fetchQueue.h"
+#include "backoff.h"
+
+using namespace std::chrono;
+
+// Part of its freshness budget a source must have used to be fetched along with another source that is due.
+// Fetching them together keeps the Wi-Fi module busy in one burst instead of waking it up for each source
+#define REFRESH_BATCH_FRACTION 0.5
+
+// How fresh the data from one source must be kept
+struct RefreshSource {
+    bool enabled = false;
+
+    // Seconds the data may get before it is fetched again, while its screen is hidden and while it is shown
+    int freshness = 0;
+    int visibleFreshness = 0;
+
+    // Seconds between two fetches at least, also when they fail
+    int minInterval = 0;
+
+    bool fetched = false;
+
+    // Queued by the scheduler and not yet run. The data still looks old while the fetch runs, so the
+    // source isn't queued again until then
+    bool inFlight = false;
+
+    Kernel::Clock::time_point lastSuccess;
+    Kernel::Clock::time_point lastAttempt;
+};
+
+// Decides when each source is fetched. Replaces the fixed checks each screen used to make
+class RefreshScheduler {
+public:
+    // Declares a source. Sources not declared are never fetched by the scheduler
+    void configure(FetchJob job, int freshness, int visibleFreshness, int minInterval);
+
+    // Changes the freshness budget of a source, for example the clock as its sync interval grows
+    void setFreshness(FetchJob job, int freshness, int visibleFreshness);
+
+    // Tells the scheduler which source the screen shows. FetchJobCount when it shows none
+    void setVisible(FetchJob job);
+
+    // Called by the network thread when a fetch has run
+    void fetched(FetchJob job, bool succeeded);
+
+    // Called by the network thread when a job was taken but not run, since its endpoint is backing off
+    void skipped(FetchJob job);
+
+    // Queues the sources that are due, and the sources close to due along with them. Returns true if the
+    // visible source was queued
+    bool poll(FetchQueue *queue, const CircuitBreaker *health);
+
+private:
+    int budget(FetchJob job) const;
+
+    RefreshSource _sources[FetchJobCount];
+    FetchJob _visible = FetchJobCount;
+    Mutex _mutex;
+};
+
+#endif // SMARTWATCH_REFRESH_SCHEDULER_H
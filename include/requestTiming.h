@@ -0,0 +1,41 @@
+/**
+ * @file   requestTiming.h
+ * @author Tobias Kallevik
+*/
+
+#ifndef SMARTWATCH_REQUEST_TIMING_H
+#define SMARTWATCH_REQUEST_TIMING_H
+
+// Includes
+#include <cstdint>
+
+// The phases of a request the time is split into
+enum TimingPhase {
+    // Host lookup. Near zero when the DNS cache has the host
+    TimingDns,
+    // TCP connect. Zero when a pooled connection is reused
+    TimingConnect,
+    // TLS handshake. Zero for plain HTTP and reused connections
+    TimingTls,
+    // From the request being sent until the first byte of the answer
+    TimingFirstByte,
+    // From the first byte until the answer is read
+    TimingTransfer,
+    // The whole request, including any retry
+    TimingTotal,
+    TimingPhaseCount
+};
+
+// Where the time of one request went, filled in by the client that sent it
+struct RequestTiming {
+    int32_t ms[TimingPhaseCount] = {};
+    uint32_t bytesSent = 0;
+    uint32_t bytesReceived = 0;
+
+    // Network error, and the HTTP status if there was a response
+    int result = 0;
+    int status = 0;
+    bool reused = false;
+};
+
+#endif // SMARTWATCH_REQUEST_TIMING_H
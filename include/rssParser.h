@@ -0,0 +1,89 @@
+/**
+ * @file   rssParser.h
+ * @author Tobias Kallevik
+*/
+
+#ifndef SMARTWATCH_RSS_PARSER_H
+#define SMARTWATCH_RSS_PARSER_H
+
+// Includes
+#include <cstddef>
+
+// Longest title kept, including the terminating null. Longer titles are cut
+#define RSS_TITLE_SIZE 160
+
+// Longest tag name that is compared. Longer names never match the tags the parser looks for
+#define RSS_TAG_SIZE 12
+
+// Longest entity name, for example "amp" in &amp;
+#define RSS_ENTITY_SIZE 8
+
+// Called with the feed title (item 0) and with the title of each item (1, 2, ...) as the item ends
+typedef void (*RssTitleHandler)(void *context, int item, const char *title);
+
+// Reads the feed title and the item titles from an RSS feed as it arrives. Only one title is held
+// at a time, so memory use doesn't depend on the size of the feed
+class RssParser {
+public:
+    RssParser(int maxItems, RssTitleHandler handler, void *context);
+
+    // Forgets all state so a new feed can be parsed
+    void reset();
+
+    // Parses the next part of the feed. Returns false once maxItems items have been read
+    bool feed(const char *data, size_t length);
+
+    bool complete() const { return _items >= _maxItems; }
+    int items() const { return _items; }
+
+private:
+    enum State {
+        Text,
+        TagStart,
+        TagName,
+        TagAttributes,
+        TagQuote,
+        Markup,
+        CData,
+        Comment,
+        Skip,
+        Entity
+    };
+
+    void step(char c);
+    void endTagName();
+    void startElement();
+    void endElement();
+    void titleChar(char c);
+    void endEntity();
+    void emitTitle(int item);
+
+    int _maxItems;
+    RssTitleHandler _handler;
+    void *_context;
+
+    State _state;
+    int _items;
+    bool _inItem;
+    bool _inTitle;
+    bool _haveFeedTitle;
+
+    // Tag being read
+    char _tag[RSS_TAG_SIZE];
+    size_t _tagLength;
+    bool _closingTag;
+    bool _selfClosing;
+    char _quote;
+
+    // Progress through "<![CDATA[" or "<!--" and through the "]]>" or "-->" that ends them
+    int _markupMatched;
+    int _endMatched;
+
+    char _entity[RSS_ENTITY_SIZE];
+    size_t _entityLength;
+
+    char _title[RSS_TITLE_SIZE];
+    size_t _titleLength;
+};
+
+#endif // SMARTWATCH_RSS_PARSER_H
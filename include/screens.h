@@ -12,7 +12,7 @@
 #include "mbed.h"
 #include "time.h"
 #include "rtos.h"
-#include "DFRobot_RGBLCD.h"
+#include "displayService.h"
 #include "HTS221Sensor.h"
 #include <algorithm>
 #include <cstdint>
@@ -26,6 +26,24 @@
 #include "apiThreads.h"
 #include "utilities.h"
 
+// Time in ms each bootup screen is shown. Set in mbed_app.json
+#ifndef MBED_CONF_APP_BOOT_SCREEN_TIME
+#define MBED_CONF_APP_BOOT_SCREEN_TIME 2000
+#endif
+
+// Time in ms between two redraws of the screen. Only the characters that changed are sent to the LCD. Set in mbed_app.json
+#ifndef MBED_CONF_APP_FRAME_TIME
+#define MBED_CONF_APP_FRAME_TIME 50
+#endif
+
+// Waits 5 ms after every transfer to the LCD instead of the time each command takes, for slow panels. Set in mbed_app.json
+#ifndef MBED_CONF_APP_LCD_CONSERVATIVE_TIMING
+#define MBED_CONF_APP_LCD_CONSERVATIVE_TIMING false
+#endif
+
+// Seconds each page of the diagnostics screen is shown. Every endpoint has a timing page and a circuit breaker page
+#define DIAGNOSTICS_PAGE_TIME 3
+
 struct ChangeLocationData {
     // Wether manu variables
     bool changeLocation = false;
@@ -35,13 +53,14 @@ struct ChangeLocationData {
 };
 
 // Menu/screen functions
-void bootUp(SharedData *sharedData, DFRobot_RGBLCD *lcd);
-void mainMenu(AlarmData *alarmData, SystemTimeData *systemTimeData, DFRobot_RGBLCD *lcd);
-void alarmMenu(AlarmData *alarmData, DFRobot_RGBLCD *lcd, AnalogIn *pot);
-void sensorMenu(DFRobot_RGBLCD *lcd, HTS221Sensor *hts221);
-void weatherMenu(SharedData *sharedData, DFRobot_RGBLCD *lcd);
-void changeLocationMenu(SharedData *sharedData, DFRobot_RGBLCD *lcd, AnalogIn *pot, Thread *weatherThread, ChangeLocationData *changeLocationData);
-string rssMenu(SharedData *sharedData, DFRobot_RGBLCD *lcd, bool *menuSwitched);
+void bootUp(SharedData *sharedData, LcdCanvas *lcd);
+void mainMenu(AlarmData *alarmData, SystemTimeData *systemTimeData, LcdCanvas *lcd);
+void alarmMenu(AlarmData *alarmData, LcdCanvas *lcd, AnalogIn *pot);
+void sensorMenu(LcdCanvas *lcd, HTS221Sensor *hts221);
+void weatherMenu(SharedData *sharedData, LcdCanvas *lcd);
+void changeLocationMenu(SharedData *sharedData, LcdCanvas *lcd, AnalogIn *pot, ChangeLocationData *changeLocationData);
+void rssMenu(SharedData *sharedData, LcdCanvas *lcd);
+void diagnosticsMenu(SharedData *sharedData, LcdCanvas *lcd);
 
 
 
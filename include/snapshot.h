@@ -0,0 +1,57 @@
+/**
+ * @file   snapshot.h
+ * @author Tobias Kallevik
+*/
+
+#ifndef SMARTWATCH_SNAPSHOT_H
+#define SMARTWATCH_SNAPSHOT_H
+
+// Includes
+#include "mbed.h"
+#include <cstdint>
+#include <type_traits>
+
+// Holds the latest published copy of some fetched data. The fetcher builds the new data in its own
+// struct and publishes it in one step, and the screens read the latest copy without ever waiting for a
+// fetch to finish.
+//
+// There are two buffers. publish() writes the one not being shown and then bumps the version, which
+// also switches the buffers. A reader copies the buffer for the version it saw and retries if the
+// version changed meanwhile, since the buffer may then have been rewritten during the copy. Only one
+// thread may publish, which holds since all fetches run on the network thread.
+template <typename T>
+class Snapshot {
+    static_assert(std::is_trivially_copyable<T>::value, "Snapshot data must be trivially copyable, use char arrays instead of strings");
+
+public:
+    Snapshot() : _version(0) {
+        _buffers[0] = T();
+        _buffers[1] = T();
+    }
+
+    void publish(const T &data) {
+        uint32_t next = core_util_atomic_load_u32(&_version) + 1;
+        _buffers[next & 1] = data;
+        core_util_atomic_store_u32(&_version, next);
+    }
+
+    // Copies the latest data. Returns the version read, which is 0 until the first publish
+    uint32_t read(T *data) const {
+        while (true) {
+            uint32_t version = core_util_atomic_load_u32(&_version);
+            *data = _buffers[version & 1];
+            if (core_util_atomic_load_u32(&_version) == version) {
+                return version;
+            }
+        }
+    }
+
+    // Increases with every publish, so a screen can tell if it has new data to draw
+    uint32_t version() const { return core_util_atomic_load_u32(&_version); }
+
+private:
+    T _buffers[2];
+    volatile uint32_t _version;
+};
+
+#endif // SMARTWATCH_SNAPSHOT_H
@@ -0,0 +1,47 @@
+/**
+ * @file   sntpClient.h
+ * @author Tobias Kallevik
+*/
+
+#ifndef SMARTWATCH_SNTP_CLIENT_H
+#define SMARTWATCH_SNTP_CLIENT_H
+
+// Includes
+#include "mbed.h"
+#include "sntpPacket.h"
+#include "dnsCache.h"
+#include "requestTiming.h"
+
+// Server asked for the time. Can be pointed at a local server when testing. Set in mbed_app.json
+#ifndef MBED_CONF_APP_SNTP_SERVER
+#define MBED_CONF_APP_SNTP_SERVER "pool.ntp.org"
+#endif
+
+#ifndef MBED_CONF_APP_SNTP_PORT
+#define MBED_CONF_APP_SNTP_PORT 123
+#endif
+
+// Time in ms to wait for the answer
+#ifndef MBED_CONF_APP_SNTP_TIMEOUT
+#define MBED_CONF_APP_SNTP_TIMEOUT 3000
+#endif
+
+// Gets the time from an SNTP server with a single UDP request, which is far cheaper than a HTTPS request
+class SntpClient {
+public:
+    void setNetwork(NetworkInterface *network, DnsCache *dns);
+
+    // Asks the server for the time. The time is valid at receivedAt, so the caller can add the time
+    // passed since then before using it. If timing is given, it is filled with where the time went
+    nsapi_error_t query(SntpTime *time, Kernel::Clock::time_point *receivedAt, RequestTiming *timing = nullptr);
+
+private:
+    nsapi_error_t exchange(const SocketAddress &address, SntpTime *time, Kernel::Clock::time_point *receivedAt, RequestTiming *timing);
+
+
+    NetworkInterface *_network = nullptr;
+    DnsCache *_dns = nullptr;
+    uint32_t _requests = 0;
+};
+
+#endif // SMARTWATCH_SNTP_CLIENT_H
@@ -0,0 +1,37 @@
+/**
+ * @file   sntpPacket.h
+ * @author Tobias Kallevik
+*/
+
+#ifndef SMARTWATCH_SNTP_PACKET_H
+#define SMARTWATCH_SNTP_PACKET_H
+
+// Includes
+#include <cstddef>
+#include <cstdint>
+
+// Size of an SNTP packet without extensions or authentication
+#define SNTP_PACKET_SIZE 48
+
+// Server time read from an SNTP response
+struct SntpTime {
+    // Time in microseconds since the unix epoch (UTC) when the response arrived, the server's
+    // transmit time plus half the network delay
+    int64_t unixTimeUs;
+
+    // Time the request and response spent on the network, without the server's processing time
+    int64_t delayUs;
+
+    int stratum;
+};
+
+// Builds a client request (version 4, mode 3). The transmit timestamp is only used to match the
+// response, which echoes it in its originate timestamp, so it can be any value not used before
+void sntpBuildRequest(uint8_t packet[SNTP_PACKET_SIZE], uint64_t transmitTimestamp);
+
+// Checks a response and reads the time from it. roundTripUs is the time measured locally from
+// sending the request until the response arrived. Returns false if the response isn't an answer
+// to the request or the server isn't synchronized
+bool sntpParseResponse(const uint8_t *packet, size_t length, uint64_t transmitTimestamp, int64_t roundTripUs, SntpTime *time);
+
+#endif // SMARTWATCH_SNTP_PACKET_H
@@ -0,0 +1,72 @@
+/**
+ * @file   tlsContext.h
+ * @author Tobias Kallevik
+*/
+
+#ifndef SMARTWATCH_TLS_CONTEXT_H
+#define SMARTWATCH_TLS_CONTEXT_H
+
+// Includes
+#include "mbed.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/x509_crt.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+
+// TLS setup shared by every connection to one server. The CA certificate is parsed and the
+// random generator seeded once, and the session from the last handshake is kept for resumption
+class TlsContext {
+public:
+    TlsContext();
+    ~TlsContext();
+
+    // Parses the CA certificate and sets up the client configuration. Called once at boot
+    nsapi_error_t init(const char *caCert);
+    bool ready() const { return _ready; }
+
+    const mbedtls_ssl_config *config() const { return &_config; }
+
+    // Offers the saved session to the server on a new connection
+    void restoreSession(mbedtls_ssl_context *ssl);
+    // Saves the session after a successful handshake
+    void saveSession(const mbedtls_ssl_context *ssl);
+    // Forgets the saved session so the next handshake is a full one
+    void clearSession();
+
+private:
+    mbedtls_entropy_context _entropy;
+    mbedtls_ctr_drbg_context _ctrDrbg;
+    mbedtls_x509_crt _caChain;
+    mbedtls_ssl_config _config;
+    mbedtls_ssl_session _session;
+    bool _hasSession = false;
+    bool _ready = false;
+    Mutex _mutex;
+};
+
+// TLS connection running on top of a connected TCP socket, using the setup from a TlsContext
+class TlsStream {
+public:
+    TlsStream(TlsContext *context, TCPSocket *socket);
+    ~TlsStream();
+
+    // Performs the handshake, resuming the previous session if the server accepts it
+    nsapi_error_t handshake(const char *host);
+
+    nsapi_size_or_error_t send(const void *data, nsapi_size_t length);
+    nsapi_size_or_error_t recv(void *data, nsapi_size_t length);
+
+    // Tells the server the connection is closing. The TCP socket is closed by its owner
+    void close();
+
+private:
+    static int bioSend(void *context, const unsigned char *data, size_t length);
+    static int bioRecv(void *context, unsigned char *data, size_t length);
+
+    TlsContext *_context;
+    TCPSocket *_socket;
+    mbedtls_ssl_context _ssl;
+    bool _connected = false;
+};
+
+#endif // SMARTWATCH_TLS_CONTEXT_H
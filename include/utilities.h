@@ -12,7 +12,7 @@
 #include "mbed.h"
 #include "time.h"
 #include "rtos.h"
-#include "DFRobot_RGBLCD.h"
+#include "displayService.h"
 #include "HTS221Sensor.h"
 #include <algorithm>
 #include <cstdint>
@@ -53,6 +53,9 @@ struct SystemTimeData {
     time_t currentEpochTime = 0;
     time_t clockInSec = 0;   
 
+    // Corrects the RTC for its drift between syncs
+    ClockDiscipline *clockDiscipline = nullptr;
+
     Mutex mutex;
 };
 
@@ -60,9 +63,7 @@ struct SystemTimeData {
 // Utility functiuon
 void systemTimeThreadFunc(void *arg);
 void alarmCheck(AlarmData *alarmData, SystemTimeData *systemTimeData, PwmOut *buzzer);
-void weatherApiCheck(SharedData *sharedData, DFRobot_RGBLCD *lcd);
-void timeApiCheck(SharedData *sharedData, DFRobot_RGBLCD *lcd);
-void scrollFeed(bool *menuSwitched, string rssFeed, AlarmData *alarmData, SystemTimeData *systemTimeData, PwmOut *buzzer, DFRobot_RGBLCD *lcd);
+void refreshCheck(SharedData *sharedData, FetchJob visible, LcdCanvas *lcd);
 void connectToNetwork(SharedData *sharedData);
 
 #endif // EXAMPROJECT_UTILITES_H
\ No newline at end of file
@@ -6,336 +6,375 @@
 */
 
 #include "apiThreads.h"
+#include "inflater.h"
+#include <cinttypes>
 #include <cstdio>
-#include "TLSSocket.h"
-#include "ipgeolocation_ca_certificate.h"
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// Passes the received part of a JSON response on to the extractor. Stops the transfer if the JSON is broken
+static bool jsonBodyHandler(void *context, const char *data, size_t length) {
+    JsonExtractor *extractor = static_cast<JsonExtractor*>(context);
+    return extractor->feed(data, length);
+}
 
-// Thread to run the API from ipgeolocation.io
-void timeThreadFunc(void *arg) {
-   
-    SharedData* sharedData = static_cast<SharedData*>(arg);
+// Gets time and location from the API at ipgeolocation.io
+nsapi_error_t fetchTime(SharedData *sharedData) {
+
+    // Takes timestamp
+    sharedData->mutex.lock();
+    sharedData->lastTimeApiRunTime = time(NULL);
+    sharedData->mutex.unlock();
+
+    // The fields used from the response. They are picked out while the response arrives, so the whole JSON document is never stored
+    JsonField fields[] = {
+        {"date_time_unix"},
+        {"timezone_offset_with_dst"},
+        {"geo.latitude"},
+        {"geo.longitude"},
+        {"geo.state_prov"}
+    };
+    JsonExtractor extractor(fields, sizeof(fields) / sizeof(fields[0]));
+
+    // Sends the request over the pooled TLS connection to the API server. The TLS context resumes the previous session when possible
+    HttpRequest request("GET", "api.ipgeolocation.io", "/timezone?apiKey=3a3e3d923a45438581920fee5e4b26d1");
+    HttpResponse response;
+    RequestTiming timing;
+    nsapi_error_t result = sharedData->http.send(request, 443, &response, &sharedData->ipgeolocationTls, jsonBodyHandler, &extractor, &timing);
+    sharedData->stats.record(FetchTime, timing);
+
+    // If test to ensure a valid response before using the data
+    if (result != NSAPI_ERROR_OK || !extractor.foundAll()) {
+        printf("\nFailed to get data from API server: %d", result);
+        return result != NSAPI_ERROR_OK ? result : FETCH_ERROR_BAD_RESPONSE;
+    }
 
-    while (true) {
-        // Wait for signal, locks mutex and takes timestamp
-        sharedData->timeThreadFlag.wait_all(timeFlagBtn);
+    // Extracts the data. The unix time has decimals which are cut off
+    uint32_t epochtime = strtoul(extractor.value("date_time_unix"), nullptr, 10);
+    TimeSnapshot snapshot;
+    snapshot.timezoneOffsetWithDst = atoi(extractor.value("timezone_offset_with_dst"));
+    strcpy(snapshot.latitude, extractor.value("geo.latitude"));
+    strcpy(snapshot.longitude, extractor.value("geo.longitude"));
+    printf("\nTime: %" PRIu32 " Offset: %d Lat: %s Lon: %s\n", epochtime, snapshot.timezoneOffsetWithDst, snapshot.latitude, snapshot.longitude);
+
+    // Sets the RTC and publishes the data. The time is only good to a second, so the clock rate isn't measured from it
+    time_t localTime = epochtime + (snapshot.timezoneOffsetWithDst * 3600);
+    set_time(localTime);
+    sharedData->clockDiscipline.stepped((int64_t)localTime * 1000000);
+    sharedData->timeSnapshot.publish(snapshot);
+
+    // Takes the time stamps again since the RTC has just been set. Only extracts the city once to avoid overwriting user set city
+    sharedData->mutex.lock();
+    sharedData->lastTimeApiRunTime = time(NULL);
+    if (sharedData->firstTimeApiRun == true) {
+        sharedData->city = extractor.value("geo.state_prov");
+        sharedData->firstTimeApiRun = false;
+    }
+
+    sharedData->mutex.unlock();
+    return NSAPI_ERROR_OK;
+}
+
+// Resyncs the RTC with a single SNTP request. The timezone offset comes from the last time API fetch, which is
+// only redone once a day or if SNTP fails, since it costs a TLS handshake and a JSON response
+nsapi_error_t fetchClock(SharedData *sharedData) {
+
+    sharedData->mutex.lock();
+    time_t lastTimeApiRunTime = sharedData->lastTimeApiRunTime;
+    sharedData->mutex.unlock();
+
+    TimeSnapshot timeSnapshot;
+    if (sharedData->timeSnapshot.read(&timeSnapshot) == 0 || lastTimeApiRunTime + TIME_API_INTERVAL <= time(NULL)) {
+        return fetchTime(sharedData);
+    }
+
+    SntpTime sntpTime;
+    Kernel::Clock::time_point receivedAt;
+    RequestTiming timing;
+    nsapi_error_t result = sharedData->sntp.query(&sntpTime, &receivedAt, &timing);
+    sharedData->stats.record(FetchClock, timing);
+    if (result != NSAPI_ERROR_OK) {
+        printf("\nFailed to get time from SNTP server: %d", result);
+        return fetchTime(sharedData);
+    }
+
+    // Lets the clock discipline measure how far the RTC drifted since the last sync
+    int64_t nowUs = sntpTime.unixTimeUs + duration_cast<microseconds>(Kernel::Clock::now() - receivedAt).count();
+    int64_t localUs = nowUs + (int64_t)timeSnapshot.timezoneOffsetWithDst * 3600 * 1000000;
+    sharedData->clockDiscipline.observe(localUs);
+
+    // The RTC only counts whole seconds, so it is set at the start of the next second to not lose the fraction
+    thread_sleep_for((1000000 - localUs % 1000000) / 1000);
+    set_time(localUs / 1000000 + 1);
+    printf("\nClock synced, delay %d ms, stratum %d\n", (int)(sntpTime.delayUs / 1000), sntpTime.stratum);
+    return NSAPI_ERROR_OK;
+}
+
+// Gets weather data from the API at weatherapi.com
+nsapi_error_t fetchWeather(SharedData *sharedData) {
+
+    // Takes the city to get the weather for
+    sharedData->mutex.lock();
+    string city = sharedData->city;
+    sharedData->mutex.unlock();
+
+    // The fields used from the response. An error message is sent instead of the weather if the city isn't recognized
+    JsonField fields[] = {
+        {"current.temp_c"},
+        {"current.condition.text"},
+        {"error.message"}
+    };
+    JsonExtractor extractor(fields, sizeof(fields) / sizeof(fields[0]));
+
+    // Builds the weather request and sends it over the pooled connection. The server is asked to only send the weather if it changed
+    HttpRequest request("GET", "api.weatherapi.com", "/v1/current.json?key=4d53a85a07d04f84a72210133232802&q=" + city);
+    sharedData->weatherValidators.apply(&request);
+    HttpResponse response;
+    RequestTiming timing;
+    nsapi_error_t result = sharedData->http.send(request, 80, &response, nullptr, jsonBodyHandler, &extractor, &timing);
+    sharedData->stats.record(FetchWeather, timing);
+
+    // The published weather is still current if the server answers 304 Not Modified
+    if (result == NSAPI_ERROR_OK && response.status == 304) {
+        return NSAPI_ERROR_OK;
+    }
+
+    // If test to ensure a response before trying to use the data
+    if (result != NSAPI_ERROR_OK || !extractor.done()) {
+        printf("\nFailed to get data from API server: %d", result);
+        return result != NSAPI_ERROR_OK ? result : FETCH_ERROR_BAD_RESPONSE;
+    }
+
+    // If the response contains an error, it means that the city tried to retrive weather data from wasn't recognized. This need to be done since user can change city
+    if (extractor.value("error.message") != nullptr) {
+        printf("\n%s", extractor.value("error.message"));
         sharedData->mutex.lock();
-        sharedData->lastTimeApiRunTime = time(NULL);
-
-        // Sets up the TLS socket
-        SocketAddress address;
-        sharedData->network->get_ip_address(&address);
-        TLSSocket *socket = new TLSSocket;
-        socket->set_timeout(500);
-        socket->open(sharedData->network);
-
-        // Connects the TLS socket to the API server
-        const char host[] = "api.ipgeolocation.io";
-        sharedData->network->gethostbyname(host, &address);
-        address.set_port(443);
-        socket->set_root_ca_cert(ipgeolocation_ca_certificate);
-        nsapi_size_or_error_t result = socket->connect(address);
-
-        // If test to ensure connection before trying to send/recive data
-        if (result != 0) {
-            // Closes and deletes the socket
-            socket->close();
-            delete socket;
-            printf("\nFailed to connect to API server");
-            // Clears the thread flag, ensuring only one run per "call"
-            sharedData->timeThreadFlag.clear(timeFlagBtn); 
-            // Unlocks the mutex
-             sharedData->mutex.unlock(); 
-            // Starts at the top of the loop again
-            continue;
-        }
+        sharedData->city = "error";
+        sharedData->mutex.unlock();
+    } else if (extractor.value("current.temp_c") != nullptr && extractor.value("current.condition.text") != nullptr) {
+        // Extracts the data and publishes it
+        WeatherSnapshot snapshot;
+        snapshot.outdoorTemp = atoi(extractor.value("current.temp_c"));
+        strcpy(snapshot.weatherCondition, extractor.value("current.condition.text"));
+        printf("\n%s %s\n", snapshot.weatherCondition, extractor.value("current.temp_c"));
+        sharedData->weatherSnapshot.publish(snapshot);
+        sharedData->weatherValidators.store(request, response);
+    } else {
+        // An error page without the weather, which isn't counted as a fetch
+        printf("\nNo weather in response, status %d", response.status);
+        return FETCH_ERROR_BAD_RESPONSE;
+    }
 
-        // Creates the request to be sent
-        const char request[] = "GET /timezone?apiKey=3a3e3d923a45438581920fee5e4b26d1 HTTP/1.1\r\n"
-                               "Host: api.ipgeolocation.io\r\n"
-                               "Connection: close\r\n""\r\n";
+    return NSAPI_ERROR_OK;
+}
 
-        // Gets the length of the message and inizialises bytes_sent to 0
-        nsapi_size_t bytes_to_send = strlen(request);
-        nsapi_size_or_error_t bytes_sent = 0; 
+// Stores the titles in the snapshot as the parser finds them. Item 0 is the feed title, the rest are news titles
+static void rssTitleHandler(void *context, int item, const char *title) {
+    RssSnapshot *snapshot = static_cast<RssSnapshot*>(context);
+    if (item == 0) {
+        strcpy(snapshot->rssFeedTitle, title);
+    } else if (item <= RSS_NEWS_ITEMS) {
+        strcpy(snapshot->newsTitles[item - 1], title);
+    }
+}
 
-        // Sends the GET request to the API server
-        while (bytes_to_send) {
-            bytes_sent = socket->send(request + bytes_sent, bytes_to_send); // Sends a chunk of the message staring from the last byte sent
-            bytes_to_send -= bytes_sent; // Subtracts the number of sent bytes from the remaing bytes
-        }
+// Passes the received part of the feed to the parser. Stops the transfer once enough items have been read
+// This is done to reduce the time needed to recive data. The RSS feed is big and takes a bit of time to recive. Since we only need 3, we can shorten the load time by stopping here.
+static bool rssBodyHandler(void *context, const char *data, size_t length) {
+    RssParser *parser = static_cast<RssParser*>(context);
+    return parser->feed(data, length);
+}
 
-        // Variables used for reciving the response
-        static char buffer[1200];
-        int buffer_length = sizeof(buffer);
-        memset(buffer, 0, buffer_length);
-        int remaining_bytes = buffer_length;
-        int received_bytes = 0;
+// What the RSS response is passed through. The body goes to the parser through the gzip decoder if the server compressed it
+struct RssStream {
+    HttpResponse *response;
+    GzipDecoder *gzip;
+    RssParser *parser;
+};
+
+static bool rssStreamHandler(void *context, const char *data, size_t length) {
+    RssStream *stream = static_cast<RssStream*>(context);
+    if (stream->response->gzip) {
+        return stream->gzip != nullptr && stream->gzip->feed(data, length);
+    }
+    return rssBodyHandler(stream->parser, data, length);
+}
 
-        // Recives the response
-        while (remaining_bytes > 0) {
-            nsapi_size_or_error_t result = socket->recv(buffer + received_bytes, remaining_bytes);
-            if (result <= 0) break;
+// Gets the RSS feed
+nsapi_error_t fetchRss(SharedData *sharedData) {
+
+    // Sends the GET request over the pooled connection. The titles are picked out by the parser while the feed arrives
+    // Items missing from a short feed are left empty. The snapshot is static since it's too big for the thread stack
+    HttpRequest request("GET", "feeds.feedburner.com", "/TheHackersNews?format-xml");
+    sharedData->rssValidators.apply(&request);
+    HttpResponse response;
+    static RssSnapshot snapshot;
+    memset(&snapshot, 0, sizeof(snapshot));
+    RssParser parser(RSS_NEWS_ITEMS, rssTitleHandler, &snapshot);
+
+    // Asks for the feed gzip compressed, which is several times smaller, if there is memory for the decoder window.
+    // The decoder is only held during the transfer
+    GzipDecoder *gzip = new (std::nothrow) GzipDecoder(rssBodyHandler, &parser);
+    if (gzip != nullptr && gzip->init()) {
+        request.addHeader("Accept-Encoding", "gzip");
+    } else {
+        delete gzip;
+        gzip = nullptr;
+    }
 
-            received_bytes += result;
-            remaining_bytes -= result;
-        }
+    RssStream stream = {&response, gzip, &parser};
+    RequestTiming timing;
+    nsapi_error_t result = sharedData->http.send(request, 80, &response, nullptr, rssStreamHandler, &stream, &timing);
+    sharedData->stats.record(FetchRss, timing);
+    bool gzipFailed = gzip != nullptr && gzip->failed();
+    delete gzip;
+
+    // If test to ensure a response before trying to parse the data. A broken compressed feed would leave the titles empty
+    if (result != NSAPI_ERROR_OK || gzipFailed) {
+        printf("\nFailed to get RSS feed: %d", result);
+        return result != NSAPI_ERROR_OK ? result : FETCH_ERROR_BAD_RESPONSE;
+    }
 
-        // Closes and deletes the socket
-        socket->close();
-        delete socket;
-
-        // Parses the data to a JSON object
-        char *json_begin = strchr(buffer, '{');
-        char *json_end = strrchr(buffer, '}');
-        json_end[1] = 0;
-        printf("\n%s\n", json_begin);
-        json jComplete = json::parse(json_begin);
-
-        // Extracts the JSON
-        size_t epochtime = jComplete["date_time_unix"];
-        sharedData->timezoneOffsetWithDst = jComplete["timezone_offset_with_dst"];
-        sharedData->latitude = jComplete["geo"]["latitude"];
-        sharedData->longitude = jComplete["geo"]["longitude"];
-        
-        // Sets the RTC
-        set_time(epochtime + (sharedData->timezoneOffsetWithDst * 3600));
-
-        // Clears the thread flag. This ensures the thread only runs one time when called
-        sharedData->timeThreadFlag.clear(timeFlagBtn); 
-        
-        // Sets an event flag to unlock the main thread after first run, only extracts the city once to avoid overwriting user set city
-        if (sharedData->firstTimeApiRun == true) {
-            sharedData->mainThreadFlag.set(mainFlagBtn); 
-            sharedData->city = jComplete["geo"]["state_prov"];
-            sharedData->firstTimeApiRun = false;
-        }
-        
-        // Unlocks the mutex
-        sharedData->mutex.unlock(); 
+    // The feed hasn't changed since the last fetch, so the published titles are kept. A 304 has no body, so nothing was parsed
+    if (response.status == 304) {
+        return NSAPI_ERROR_OK;
+    }
+
+    // An error page, or a compressed feed when there was no memory for the decoder, leaves the titles empty.
+    // They aren't published, so the last good titles stay on the screen and in flash
+    if (response.status < 200 || response.status > 299 || parser.items() == 0) {
+        printf("\nNo titles in RSS response, status %d", response.status);
+        return FETCH_ERROR_BAD_RESPONSE;
     }
+
+    printf("\n%s\n", snapshot.rssFeedTitle);
+    for (int i = 0; i < RSS_NEWS_ITEMS; i++) {
+        printf("%s\n", snapshot.newsTitles[i]);
+    }
+
+    // Publishes the titles and keeps the validators for the next fetch
+    sharedData->rssSnapshot.publish(snapshot);
+    sharedData->rssValidators.store(request, response);
+
+    return NSAPI_ERROR_OK;
 }
 
-// Thread to run the API from weatherapi.com provides weather data
-void weatherThreadFunc(void *arg) {
+// The record is static since it's too big for the thread stacks. It's only used at boot and by the network thread
+static CachedData cachedData;
 
-    SharedData* sharedData = static_cast<SharedData*>(arg);
-    
-    while (true) {
-        // Wait for signal, locks mutex and takes timestamp
-        sharedData->weatherThreadFlag.wait_all(weatherFlagBtn);
-        sharedData->mutex.lock(); 
-        sharedData->lastWeatherApiRunTime = time(NULL); 
-
-        // Creates TCP socket and address objects
-        TCPSocket socket; 
-        SocketAddress address; 
-
-        // Finds the destination IP, sets the port number, opens a socket and connect the socket
-        sharedData->network->gethostbyname("api.weatherapi.com", &address); //
-        address.set_port(80);   
-        socket.open(sharedData->network); 
-        nsapi_size_or_error_t result = socket.connect(address); 
-
-        // If test to ensure connection before trying to send/recive data
-        if (result != 0) {
-            // Closes the socket
-            socket.close();
-            // Sets the main thread flag, clears the weather thrad flag and clears the mutex
-            // We need to clear the main thread flag since we need to block the main thread when a user changes a city, so that we can run this thread and check if the city is valid before proceeding
-            sharedData->mainThreadFlag.set(mainFlagBtn);
-            sharedData->weatherThreadFlag.clear(weatherFlagBtn); 
-            // Unlocks the mutex
-            sharedData->mutex.unlock(); 
-            // Starts at the top of the loop again
-            continue;
-        }
+bool loadCachedData(SharedData *sharedData) {
+    if (!sharedData->store.load(&cachedData, sizeof(cachedData), CACHED_DATA_VERSION)) {
+        return false;
+    }
 
-        // Builds the weather request
-        ostringstream oss;
-        oss << "GET /v1/current.json?key=4d53a85a07d04f84a72210133232802&q=" << sharedData->city << " HTTP/1.1\r\n"
-            << "Host: api.weatherapi.com\r\n"
-            << "Connection: close\r\n"
-            << "\r\n";
-
-        string requestString = oss.str();
-        const char *request = requestString.c_str();
-    
-        // Gets the length of the message to be sent and initializes the byte_sent var to 0
-        nsapi_size_t bytes_to_send = strlen(request); 
-        nsapi_size_or_error_t bytes_sent = 0; 
-
-        // Sends the GET request
-        while (bytes_to_send) {
-            bytes_sent = socket.send(request + bytes_sent, bytes_to_send); 
-            bytes_to_send -= bytes_sent; 
-        }
+    sharedData->timeSnapshot.publish(cachedData.time);
+    sharedData->weatherSnapshot.publish(cachedData.weather);
+    sharedData->rssSnapshot.publish(cachedData.rss);
 
-        // Variables used to recive the message
-        char buffer[400];
-        int received_bytes = 0;
-        char message[1500] = {0};
-        int size = 0;
-
-        // Recives the response in chunks, gradually buliding the response char. Breaks of when result is 0, meaning the entire message has been recived
-        while (1) {
-            nsapi_size_or_error_t result = socket.recv(buffer, sizeof(buffer)); 
-            
-            if (result <= 0) break; 
-    
-            memcpy(message + size, buffer, result); 
-            size += result; 
-            thread_sleep_for(100); 
-        }  
-
-        // Closes the TCP socket
-        socket.close();
-
-        string jsonMessage = message;  
-
-        // If the response contain the word "erro", it means that the city tried to retrive weather data from wasn't recognized. This need to be done since user can change city
-        if (jsonMessage.find("error") != std::string::npos) {
-            printf("%s", jsonMessage.c_str());
-            sharedData->city = "error";
-        } else {
-            // Parses the response to a JSON object
-            int start_pos = jsonMessage.find("{"); 
-            int end_pos = jsonMessage.rfind("}}"); 
-            string output = jsonMessage.substr(start_pos, end_pos - start_pos + 2); 
-            printf("\n%s\n", output.c_str()); 
-            json jComplete = json::parse(output); 
-
-            // Extracts the data from the JSON object
-            sharedData->outdoorTemp = jComplete["current"]["temp_c"]; 
-            sharedData->weatherCondition = jComplete["current"]["condition"]["text"];
-        }
+    // A cached city was either found by the time API or set by the user, so it isn't overwritten
+    sharedData->mutex.lock();
+    sharedData->city = cachedData.city;
+    sharedData->firstTimeApiRun = false;
+    sharedData->mutex.unlock();
+    return true;
+}
 
-        // Sets the main thread flag, clears the weather thrad flag and clears the mutex
-        // We need to clear the main thread flag since we need to block the main thread when a user changes a city, so that we can run this thread and check if the city is valid before proceeding
-        sharedData->mainThreadFlag.set(mainFlagBtn);
-        sharedData->weatherThreadFlag.clear(weatherFlagBtn); 
-        sharedData->mutex.unlock(); 
-       
+void saveCachedData(SharedData *sharedData) {
+    // Zeroed first so padding and unused string bytes don't change the CRC
+    memset(&cachedData, 0, sizeof(cachedData));
+    if (sharedData->timeSnapshot.read(&cachedData.time) == 0 || sharedData->weatherSnapshot.read(&cachedData.weather) == 0 || sharedData->rssSnapshot.read(&cachedData.rss) == 0) {
+        return;
+    }
+
+    sharedData->mutex.lock();
+    bool validCity = sharedData->city != "error" && !sharedData->city.empty() && sharedData->city.size() < JSON_VALUE_SIZE;
+    if (validCity) {
+        strcpy(cachedData.city, sharedData->city.c_str());
+    }
+    sharedData->mutex.unlock();
+
+    if (validCity && sharedData->store.save(&cachedData, sizeof(cachedData), CACHED_DATA_VERSION)) {
+        printf("\nSaved data to flash");
     }
 }
 
-// Thread to get the RSS feed
-void rssThreadFunc(void *arg) {
+// Thread that runs all fetches, one at a time and the most urgent first. Having one thread share
+// the connection pool means only one stack big enough for TLS is needed
+void networkThreadFunc(void *arg) {
 
     SharedData* sharedData = static_cast<SharedData*>(arg);
-    
+
     while (true) {
-        // Wait for signal, locks mutex and takes timestamp
-        sharedData->rssThreadFlag.wait_all(rssFlagBtn);
-        sharedData->mutex.lock(); 
-        sharedData->lastRssRunTime = time(NULL); 
-
-        // Creates TCP socket and address objects
-        TCPSocket socket; 
-        SocketAddress address; 
-
-        // Finds the destination IP, sets the port number, opens a socket and connect the socket
-        sharedData->network->gethostbyname("feeds.feedburner.com", &address); //
-        address.set_port(80);
-        socket.open(sharedData->network); 
-        nsapi_size_or_error_t result = socket.connect(address);
-
-        // If test to ensure connection before trying to send/recive data
-        if (result != 0) {
-            // Closes the socket
-            socket.close();
-            // Clears the thread flag and unlocks the mutex
-            sharedData->rssThreadFlag.clear(rssFlagBtn); 
-            sharedData->mutex.unlock();
-            // Starts at the top of the loop again
-            continue;
-        }
-        
-
-        // Creates the GET request
-        const char request[] = "GET /TheHackersNews?format-xml HTTP/1.1\r\n"
-                               "Host: feeds.feedburner.com\r\n"
-                               "Connection: close\r\n""\r\n";
-    
-        // Gets the length of the message to be sent and initializes the byte_sent var to 0
-        nsapi_size_t bytes_to_send = strlen(request); 
-        nsapi_size_or_error_t bytes_sent = 0; 
-
-        // Sends the GET request
-        while (bytes_to_send) {
-            bytes_sent = socket.send(request + bytes_sent, bytes_to_send); 
-            bytes_to_send -= bytes_sent; 
+        // Waits for a job. Endpoints that failed recently are left alone until their backoff or open circuit time is over
+        FetchJob job = sharedData->fetchQueue.take();
+        nsapi_error_t result = NSAPI_ERROR_UNSUPPORTED;
+
+        // Holds the job while the link is down. Jobs queued in the meantime run once the link is back.
+        // Pooled connections died with the link, so they are dropped instead of failing on first use
+        if (sharedData->networkManager.waitUntilUp()) {
+            sharedData->http.closeAll();
         }
 
-        // Variables used to recive the message
-        string message;
-        char buffer[1500];
-        string search = "</item>";
-        
-        // Recives the response in chunks, gradually buliding the response char. We count the amount of </item> and break the loop when 3 or more items have been retrived. 
-        // This is done to reduce the time needed to recive data. The RSS feed is big and takes a bit of time to recive. Since we only need 3, we can shorten the load time by breaking the loop here. 
-        while (true) {
-            // Receive data from the socket and store the number of bytes received
-            nsapi_size_or_error_t result = socket.recv(buffer, sizeof(buffer)); 
-            message.append(buffer, result);
-
-            // Searches through the recived chunk to find occurrences of </item>.  
-            size_t pos = message.find(search);
-            int count = 0;
-            while (pos != string::npos) { 
-                count++; 
-                pos = message.find(search, pos + search.size()); // Find the next occurrence of </item> starting from last occurrenc
-            }
-
-            // Breaks the loop when three </item> have been found
-            if (count >= 3) break; 
-
-            thread_sleep_for(100); 
+        if (!sharedData->fetchHealth[job].allowed()) {
+            printf("\nSkipping fetch %d, retry in %d s", job, sharedData->fetchHealth[job].retryIn());
+            sharedData->refresh.skipped(job);
+            sharedData->fetchQueue.finish(job, false);
+            continue;
         }
 
-        // Closes the TCP socket
-        socket.close();
-
-        // Veriables used to extract the feed/title strings
-        string rssTitle, title1, title2, title3;
-        size_t start, end;
-        int count = 0;
-        
-        // Find the first occurrence of "<title>"
-        start = message.find("<title>");
-        while (start != string::npos) {
-            // Find the next occurrence of "</title>"
-            end = message.find("</title>", start);
-            if (end == string::npos) {
+        switch (job) {
+            case FetchTime:
+                result = fetchTime(sharedData);
+                break;
+
+            case FetchClock:
+                result = fetchClock(sharedData);
+                break;
+
+            case FetchWeather:
+                result = fetchWeather(sharedData);
                 break;
-            }
-            // Extract the text between the tags
-            string title = message.substr(start + 7, end - start - 7);
-            count++;
-            if (count == 1) {
-                rssTitle = title;
-            } else if (count == 2) {
-                title1 = title;
-            } else if (count == 3) {
-                title2 = title;
-            } else if (count == 4) {
-                title3 = title;
+
+            case FetchRss:
+                result = fetchRss(sharedData);
+                break;
+
+            default:
                 break;
-            }
-            // Find the next occurrence of "<title>"
-            start = message.find("<title>", end);
         }
 
-    
-        printf("\n%s\n%s\n%s\n%s\n", rssTitle.c_str(), title1.c_str(), title2.c_str(), title3.c_str());
+        // A fetch that failed because the link dropped isn't the endpoint's fault, so it runs again once the link is back.
+        // Any other failure, like an error page or a broken response, is charged to the endpoint
+        bool succeeded = result == NSAPI_ERROR_OK;
+        sharedData->networkManager.fetchDone(result);
+        if (NetworkManager::linkError(result) && !sharedData->networkManager.up()) {
+            sharedData->fetchQueue.retry(job);
+            continue;
+        }
 
-        // Adds the titles to the shared data struct. We separate the tiles for easier manipulation later
-        sharedData->rssFeedTitle = rssTitle;
-        sharedData->newsTitle1 = title1;
-        sharedData->newsTitle2 = title2;
-        sharedData->newsTitle3 = title3;
+        if (succeeded) {
+            sharedData->fetchHealth[job].succeeded();
+        } else {
+            sharedData->fetchHealth[job].failed();
+        }
 
-        // Clears the thread flag and unlocks the mutex
-        sharedData->rssThreadFlag.clear(rssFlagBtn); 
-        sharedData->mutex.unlock();
+        // Tells the scheduler. The time API also sets the clock, and either way the clock discipline may now allow a longer sync interval
+        sharedData->refresh.fetched(job, succeeded);
+        if (job == FetchTime && succeeded) {
+            sharedData->refresh.fetched(FetchClock, true);
+        }
+        if (job == FetchTime || job == FetchClock) {
+            int interval = sharedData->clockDiscipline.syncInterval();
+            sharedData->refresh.setFreshness(FetchClock, interval, interval);
+        }
+
+        // Keeps a copy of the new data in flash for the next boot
+        if (succeeded) {
+            saveCachedData(sharedData);
+        }
+
+        // Wakes anyone waiting for the job
+        sharedData->fetchQueue.finish(job, succeeded);
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,100 @@
+/**
+ * @file   backoff.cpp
+ * @author Tobias Kallevik
+*/
+
+#include "backoff.h"
+#include <cstdio>
+#include <cstdlib>
+
+Backoff::Backoff(uint32_t baseMs, uint32_t maxMs) : _baseMs(baseMs), _maxMs(maxMs), _attempt(0) {
+}
+
+// Uses "equal jitter", a wait between half and all of the doubled wait, so the wait still grows
+// with each failure but is never the same on two devices
+uint32_t Backoff::next() {
+    uint32_t delay = _maxMs;
+    if (_attempt < 31 && (_baseMs << _attempt) >> _attempt == _baseMs) {
+        delay = _baseMs << _attempt;
+        if (delay > _maxMs) {
+            delay = _maxMs;
+        }
+    }
+
+    if (_attempt < 31) {
+        _attempt++;
+    }
+
+    uint32_t half = delay / 2;
+    return half + (uint32_t)rand() % (delay - half + 1);
+}
+
+CircuitBreaker::CircuitBreaker()
+    : _backoff(MBED_CONF_APP_BACKOFF_BASE_MS, MBED_CONF_APP_BACKOFF_MAX_MS), _state(CircuitClosed), _failures(0) {
+}
+
+bool CircuitBreaker::allowed() {
+    Kernel::Clock::time_point now = Kernel::Clock::now();
+
+    _mutex.lock();
+    bool allowed = now >= _retryAt;
+    if (allowed && _state == CircuitOpen) {
+        _state = CircuitHalfOpen;
+    }
+    _mutex.unlock();
+
+    return allowed;
+}
+
+void CircuitBreaker::succeeded() {
+    _mutex.lock();
+    _state = CircuitClosed;
+    _failures = 0;
+    _backoff.reset();
+    _retryAt = Kernel::Clock::time_point();
+    _mutex.unlock();
+}
+
+// Waits longer for each failure. After too many failures in a row, or if the test fetch of a half
+// open circuit fails, the circuit opens and the endpoint is left alone for the open time
+void CircuitBreaker::failed() {
+    Kernel::Clock::time_point now = Kernel::Clock::now();
+
+    _mutex.lock();
+    _failures++;
+
+    if (_state == CircuitHalfOpen || _failures >= MBED_CONF_APP_CIRCUIT_FAILURE_THRESHOLD) {
+        _state = CircuitOpen;
+        _retryAt = now + seconds(MBED_CONF_APP_CIRCUIT_OPEN_TIME);
+        printf("\nCircuit open after %d failures", _failures);
+    } else {
+        _retryAt = now + milliseconds(_backoff.next());
+    }
+    _mutex.unlock();
+}
+
+CircuitState CircuitBreaker::state() const {
+    _mutex.lock();
+    CircuitState state = _state;
+    _mutex.unlock();
+    return state;
+}
+
+int CircuitBreaker::failures() const {
+    _mutex.lock();
+    int failures = _failures;
+    _mutex.unlock();
+    return failures;
+}
+
+int CircuitBreaker::retryIn() const {
+    Kernel::Clock::time_point now = Kernel::Clock::now();
+
+    _mutex.lock();
+    int wait = 0;
+    if (_retryAt > now) {
+        wait = duration_cast<seconds>(_retryAt - now).count() + 1;
+    }
+    _mutex.unlock();
+    return wait;
+}
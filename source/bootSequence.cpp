@@ -0,0 +1,101 @@
+/**
+ * @file   bootSequence.cpp
+ * @author Tobias Kallevik
+*/
+
+#include "bootSequence.h"
+#include <cstdio>
+
+BootSequence::BootSequence() : _count(0), _doneMask(0), _changed(_mutex) {
+}
+
+uint32_t BootSequence::add(const char *name, Callback<void()> func, uint32_t dependsOn) {
+    MBED_ASSERT(_count < BOOT_MAX_STAGES);
+
+    BootStage &stage = _stages[_count];
+    stage.name = name;
+    stage.func = func;
+    stage.dependsOn = dependsOn;
+    stage.started = false;
+    stage.done = false;
+    return 1u << _count++;
+}
+
+void BootSequence::run() {
+    _startedAt = Kernel::Clock::now();
+
+    // The workers are only needed during boot, so they are deleted afterwards to give their stacks back
+    Thread *workers[MBED_CONF_APP_BOOT_WORKERS];
+    for (int i = 0; i < MBED_CONF_APP_BOOT_WORKERS; i++) {
+        workers[i] = new Thread(osPriorityNormal, MBED_CONF_APP_BOOT_WORKER_STACK_SIZE, nullptr, "boot");
+        workers[i]->start(callback(this, &BootSequence::work));
+    }
+
+    work();
+
+    for (int i = 0; i < MBED_CONF_APP_BOOT_WORKERS; i++) {
+        workers[i]->join();
+        delete workers[i];
+    }
+
+    _doneAt = Kernel::Clock::now();
+}
+
+// Takes stages that are ready until every stage has been started
+void BootSequence::work() {
+    _mutex.lock();
+
+    while (true) {
+        int index = next();
+
+        if (index < 0) {
+            bool allStarted = true;
+            for (int i = 0; i < _count; i++) {
+                allStarted &= _stages[i].started;
+            }
+            if (allStarted) {
+                break;
+            }
+
+            _changed.wait();
+            continue;
+        }
+
+        BootStage &stage = _stages[index];
+        stage.started = true;
+        stage.startedAt = Kernel::Clock::now();
+        _mutex.unlock();
+
+        stage.func();
+
+        _mutex.lock();
+        stage.doneAt = Kernel::Clock::now();
+        stage.done = true;
+        _doneMask |= 1u << index;
+        _changed.notify_all();
+    }
+
+    _mutex.unlock();
+}
+
+// The first stage not yet started whose dependencies are all done, or -1. Called with the mutex locked
+int BootSequence::next() const {
+    for (int i = 0; i < _count; i++) {
+        if (!_stages[i].started && (_stages[i].dependsOn & _doneMask) == _stages[i].dependsOn) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+void BootSequence::printTimes() const {
+    printf("\nBoot stage        start     time");
+    for (int i = 0; i < _count; i++) {
+        const BootStage &stage = _stages[i];
+        int start = duration_cast<milliseconds>(stage.startedAt - _startedAt).count();
+        int time = duration_cast<milliseconds>(stage.doneAt - stage.startedAt).count();
+        printf("\n%-16s %6d ms %6d ms", stage.name, start, time);
+    }
+    printf("\nBoot done in %d ms\n", (int)duration_cast<milliseconds>(_doneAt - _startedAt).count());
+}
@@ -0,0 +1,93 @@
+/**
+ * @file   clockDiscipline.cpp
+ * @author Tobias Kallevik
+*/
+
+#include "clockDiscipline.h"
+#include <cmath>
+#include <cstdio>
+
+ClockDiscipline::ClockDiscipline()
+    : _synced(false), _preciseBase(false), _measurements(0), _baseUs(0), _rate(0), _rateSpread(0) {
+}
+
+void ClockDiscipline::observe(int64_t trueUs) {
+    _mutex.lock();
+
+    // The RTC was right at the last sync, so the error it shows now is the rate error times the time passed.
+    // The error is read as the time the RTC would show (the last sync plus the time passed) against the real time
+    int64_t elapsedUs = sinceSyncUs();
+    if (_synced && _preciseBase && elapsedUs > 0) {
+        double measured = (double)(trueUs - (_baseUs + elapsedUs)) / elapsedUs;
+
+        if (_measurements == 0) {
+            _rate = measured;
+            _rateSpread = fabs(measured);
+        } else {
+            _rateSpread += (fabs(measured - _rate) - _rateSpread) * CLOCK_RATE_GAIN;
+            _rate += (measured - _rate) * CLOCK_RATE_GAIN;
+        }
+        _measurements++;
+        printf("\nClock rate %.1f ppm, spread %.1f ppm", _rate * 1e6, _rateSpread * 1e6);
+    }
+
+    _synced = true;
+    _preciseBase = true;
+    _baseUs = trueUs;
+    _syncedAt = Kernel::Clock::now();
+    _mutex.unlock();
+}
+
+void ClockDiscipline::stepped(int64_t trueUs) {
+    _mutex.lock();
+    _synced = true;
+    _preciseBase = false;
+    _baseUs = trueUs;
+    _syncedAt = Kernel::Clock::now();
+    _mutex.unlock();
+}
+
+int64_t ClockDiscipline::correctionUs() const {
+    _mutex.lock();
+    int64_t correction = 0;
+    if (_synced && _measurements > 0) {
+        correction = (int64_t)(_rate * sinceSyncUs());
+    }
+    _mutex.unlock();
+    return correction;
+}
+
+// The error after the interval is about the rate spread times the interval, since the known part of the rate is corrected
+int ClockDiscipline::syncInterval() const {
+    _mutex.lock();
+    int interval = MBED_CONF_APP_CLOCK_MIN_SYNC_INTERVAL;
+
+    if (_measurements >= 2) {
+        double uncertainty = _rateSpread;
+        if (uncertainty < CLOCK_RATE_FLOOR_PPM / 1e6) {
+            uncertainty = CLOCK_RATE_FLOOR_PPM / 1e6;
+        }
+
+        double seconds = (MBED_CONF_APP_CLOCK_MAX_ERROR_MS / 1000.0) / uncertainty;
+        if (seconds > MBED_CONF_APP_CLOCK_MAX_SYNC_INTERVAL) {
+            interval = MBED_CONF_APP_CLOCK_MAX_SYNC_INTERVAL;
+        } else if (seconds > MBED_CONF_APP_CLOCK_MIN_SYNC_INTERVAL) {
+            interval = (int)seconds;
+        }
+    }
+
+    _mutex.unlock();
+    return interval;
+}
+
+double ClockDiscipline::ratePpm() const {
+    _mutex.lock();
+    double rate = _rate * 1e6;
+    _mutex.unlock();
+    return rate;
+}
+
+// Called with the mutex locked
+int64_t ClockDiscipline::sinceSyncUs() const {
+    return duration_cast<microseconds>(Kernel::Clock::now() - _syncedAt).count();
+}
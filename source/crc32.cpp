@@ -0,0 +1,21 @@
+/**
+ * @file   crc32.cpp
+ * @author Tobias Kallevik
+*/
+
+#include "crc32.h"
+
+// Computed bit by bit instead of from a table, to save the 1 KB the table would take
+uint32_t crc32(const void *data, size_t length, uint32_t crc) {
+    const uint8_t *bytes = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+
+    for (size_t i = 0; i < length; i++) {
+        crc ^= bytes[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+
+    return ~crc;
+}
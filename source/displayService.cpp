@@ -0,0 +1,153 @@
+/**
+ * @file   displayService.cpp
+ * @author Tobias Kallevik
+*/
+
+#include "displayService.h"
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+LcdCanvas::LcdCanvas(DisplayService *display) : _display(display) {
+    _cols = display->cols();
+    _rows = display->rows();
+    clear();
+}
+
+// The unused end of the ticker text is zeroed too, so frames that look the same compare equal
+void LcdCanvas::clear() {
+    memset(_frame.text, ' ', sizeof(_frame.text));
+    _frame.tickerRow = LCD_NO_TICKER;
+    memset(_frame.ticker, 0, sizeof(_frame.ticker));
+    _col = 0;
+    _row = 0;
+}
+
+void LcdCanvas::home() {
+    _col = 0;
+    _row = 0;
+}
+
+void LcdCanvas::setCursor(uint8_t col, uint8_t row) {
+    _col = col;
+    _row = row;
+}
+
+// Text past the edge is dropped, like on the LCD
+void LcdCanvas::write(char value) {
+    if (_row < _rows && _col < _cols) {
+        _frame.text[_row][_col] = value;
+    }
+    if (_col < 0xff) {
+        _col++;
+    }
+}
+
+// Anything longer than a row would be dropped anyway, so that is all that is formatted
+void LcdCanvas::printf(const char *format, ...) {
+    char buffer[LCD_MAX_COLS + 1];
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    for (const char *c = buffer; *c != '\0'; c++) {
+        write(*c);
+    }
+}
+
+// The row shows the start of the text, which is what the LCD shows if it can't run the ticker
+void LcdCanvas::ticker(uint8_t row, const char *text) {
+    _frame.tickerRow = row;
+    strncpy(_frame.ticker, text, sizeof(_frame.ticker) - 1);
+
+    setCursor(0, row);
+    for (uint8_t col = 0; col < _cols && text[col] != '\0'; col++) {
+        write(text[col]);
+    }
+}
+
+void LcdCanvas::submit() {
+    _display->submit(_frame);
+}
+
+DisplayService::DisplayService(uint8_t cols, uint8_t rows, PinName sda, PinName scl)
+    : _lcd(cols, rows, sda, scl), _dropped(0), _nextStep(),
+      _thread(osPriorityNormal, MBED_CONF_APP_DISPLAY_THREAD_STACK_SIZE, nullptr, "display") {
+    _cols = cols < LCD_MAX_COLS ? cols : LCD_MAX_COLS;
+    _rows = rows < LCD_MAX_ROWS ? rows : LCD_MAX_ROWS;
+}
+
+void DisplayService::start(bool conservativeTiming) {
+    _lcd.setConservativeTiming(conservativeTiming);
+    _thread.start(callback(this, &DisplayService::run));
+}
+
+// Only the screens submit, so there is one publisher. The flag wakes the display thread, and is kept
+// if the thread is busy sending the frame before
+void DisplayService::submit(const LcdFrame &frame) {
+    _frames.publish(frame);
+    _thread.flags_set(DISPLAY_FRAME_FLAG);
+}
+
+// Shows the latest frame each time the flag is set, and steps the ticker while one runs. A frame that
+// is the same as the one shown changes nothing, so the ticker keeps going while the screen is redrawn
+void DisplayService::run() {
+    _lcd.init();
+    memset(&_shown, 0, sizeof(_shown));
+
+    uint32_t shown = 0;
+    while (true) {
+        if (_lcd.tickerRunning()) {
+            ThisThread::flags_wait_any_until(DISPLAY_FRAME_FLAG, _nextStep);
+
+            Kernel::Clock::time_point now = Kernel::Clock::now();
+            if (now >= _nextStep) {
+                _lcd.tickerStep();
+                _nextStep = max(_nextStep + milliseconds(MBED_CONF_APP_TICKER_STEP_TIME), now);
+            }
+        } else {
+            ThisThread::flags_wait_any(DISPLAY_FRAME_FLAG);
+        }
+
+        uint32_t version = _frames.read(&_next);
+        if (version == shown) {
+            continue;
+        }
+        _dropped += version - shown - 1;
+        shown = version;
+
+        // The driver only reads the ticker text while stepping, so the frame can be replaced under it. A ticker
+        // that is the same as before keeps running from where it is
+        if (memcmp(&_next, &_shown, sizeof(_shown)) != 0) {
+            bool sameTicker = _next.tickerRow == _shown.tickerRow && strcmp(_next.ticker, _shown.ticker) == 0;
+            _shown = _next;
+            show(sameTicker);
+        }
+    }
+}
+
+// Loads the frame into the driver. The driver only sends the characters that differ from what the LCD
+// shows, or starts the ticker from a blank display. If the ticker is running and unchanged, only the
+// other rows are updated, so it isn't started over
+void DisplayService::show(bool sameTicker) {
+    for (uint8_t row = 0; row < _rows; row++) {
+        _lcd.setCursor(0, row);
+        for (uint8_t col = 0; col < _cols; col++) {
+            _lcd.write(_shown.text[row][col]);
+        }
+    }
+
+    if (sameTicker && _lcd.tickerRunning()) {
+        _lcd.tickerRedraw();
+        return;
+    }
+
+    if (_shown.tickerRow != LCD_NO_TICKER && _lcd.tickerStart(_shown.tickerRow, _shown.ticker, strlen(_shown.ticker))) {
+        _nextStep = Kernel::Clock::now() + milliseconds(MBED_CONF_APP_TICKER_STEP_TIME);
+        return;
+    }
+    _lcd.flush();
+}
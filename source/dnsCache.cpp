@@ -0,0 +1,148 @@
+/**
+ * @file   dnsCache.cpp
+ * @author Tobias Kallevik
+*/
+
+#include "dnsCache.h"
+#include <cstdio>
+#include <cstring>
+
+void DnsCache::setNetwork(NetworkInterface *network) {
+    _mutex.lock();
+    _network = network;
+    _mutex.unlock();
+}
+
+// Answers from the cache while the entry is valid. Close to expiry the cached address is still given,
+// but a new lookup is started in the background so the next fetch doesn't have to wait for it
+nsapi_error_t DnsCache::resolve(const char *host, SocketAddress *address) {
+    Kernel::Clock::time_point now = Kernel::Clock::now();
+
+    _mutex.lock();
+    DnsEntry *entry = find(host);
+
+    if (entry != nullptr && entry->expires > now) {
+        entry->lastUsed = now;
+        nsapi_error_t error = entry->error;
+        if (error == NSAPI_ERROR_OK) {
+            *address = entry->address;
+        }
+
+        bool refresh = error == NSAPI_ERROR_OK && entry->expires - now <= seconds(MBED_CONF_APP_DNS_REFRESH_AHEAD);
+        _mutex.unlock();
+
+        if (refresh) {
+            startRefresh(host);
+        }
+        return error;
+    }
+
+    NetworkInterface *network = _network;
+    _mutex.unlock();
+
+    if (network == nullptr) {
+        return NSAPI_ERROR_NO_CONNECTION;
+    }
+
+    // Looks the host up and caches the answer, also if the lookup failed
+    SocketAddress result;
+    nsapi_error_t error = network->gethostbyname(host, &result);
+    store(host, error, &result);
+
+    if (error == NSAPI_ERROR_OK) {
+        *address = result;
+    } else {
+        printf("\nFailed to resolve %s: %d", host, error);
+    }
+    return error;
+}
+
+void DnsCache::invalidate(const char *host) {
+    _mutex.lock();
+    DnsEntry *entry = find(host);
+    if (entry != nullptr) {
+        entry->used = false;
+    }
+    _mutex.unlock();
+}
+
+// Finds the entry for a host. Called with the mutex locked
+DnsEntry *DnsCache::find(const char *host) {
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        if (_entries[i].used && strcmp(_entries[i].host, host) == 0) {
+            return &_entries[i];
+        }
+    }
+    return nullptr;
+}
+
+// Saves a lookup result, replacing the least recently used host if the cache is full
+void DnsCache::store(const char *host, nsapi_error_t error, const SocketAddress *address) {
+    if (strlen(host) >= DNS_HOST_SIZE) {
+        return;
+    }
+
+    Kernel::Clock::time_point now = Kernel::Clock::now();
+
+    _mutex.lock();
+    DnsEntry *entry = find(host);
+
+    for (int i = 0; i < DNS_CACHE_SIZE && entry == nullptr; i++) {
+        if (!_entries[i].used) {
+            entry = &_entries[i];
+        }
+    }
+
+    if (entry == nullptr) {
+        entry = &_entries[0];
+        for (int i = 1; i < DNS_CACHE_SIZE; i++) {
+            if (_entries[i].lastUsed < entry->lastUsed) {
+                entry = &_entries[i];
+            }
+        }
+    }
+
+    strcpy(entry->host, host);
+    entry->error = error;
+    if (error == NSAPI_ERROR_OK) {
+        entry->address = *address;
+        entry->expires = now + seconds(MBED_CONF_APP_DNS_CACHE_TTL);
+    } else {
+        entry->expires = now + seconds(MBED_CONF_APP_DNS_NEGATIVE_TTL);
+    }
+    entry->lastUsed = now;
+    entry->used = true;
+    _mutex.unlock();
+}
+
+// Starts a background lookup of the host. The answer arrives in refreshDone
+void DnsCache::startRefresh(const char *host) {
+    _mutex.lock();
+    if (_refreshing || _network == nullptr || strlen(host) >= DNS_HOST_SIZE) {
+        _mutex.unlock();
+        return;
+    }
+    strcpy(_refreshHost, host);
+    _refreshing = true;
+    NetworkInterface *network = _network;
+    _mutex.unlock();
+
+    // Stacks without asynchronous lookups return an error here. The entry is then looked up when it expires
+    nsapi_value_or_error_t result = network->gethostbyname_async(_refreshHost, callback(this, &DnsCache::refreshDone));
+    if (result < 0) {
+        _mutex.lock();
+        _refreshing = false;
+        _mutex.unlock();
+    }
+}
+
+// Stores the background lookup. A failed refresh keeps the old address until it expires
+void DnsCache::refreshDone(nsapi_error_t result, SocketAddress *address) {
+    if (result >= 0 && address != nullptr) {
+        store(_refreshHost, NSAPI_ERROR_OK, address);
+    }
+
+    _mutex.lock();
+    _refreshing = false;
+    _mutex.unlock();
+}
@@ -0,0 +1,104 @@
+/**
+ * @file   fetchQueue.cpp
+ * @author Tobias Kallevik
+*/
+
+#include "fetchQueue.h"
+
+FetchQueue::FetchQueue() : _nextTicket(0), _changed(_mutex) {
+    for (int i = 0; i < FetchJobCount; i++) {
+        _queued[i] = false;
+        _priority[i] = PriorityBackground;
+        _order[i] = 0;
+        _queuedTicket[i] = 0;
+        _runningTicket[i] = 0;
+        _finishedTicket[i] = 0;
+        _succeeded[i] = false;
+    }
+}
+
+bool FetchQueue::request(FetchJob job, FetchPriority priority) {
+    bool added;
+    _mutex.lock();
+    queue(job, priority, &added);
+    _mutex.unlock();
+    return added;
+}
+
+bool FetchQueue::requestAndWait(FetchJob job, FetchPriority priority) {
+    bool added;
+    _mutex.lock();
+    uint32_t ticket = queue(job, priority, &added);
+
+    // Tickets only grow, so the run is done once a run with the same or a later ticket has finished
+    while (_finishedTicket[job] < ticket) {
+        _changed.wait();
+    }
+
+    bool succeeded = _succeeded[job];
+    _mutex.unlock();
+    return succeeded;
+}
+
+// Adds the job, or joins the run already waiting. Called with the mutex locked
+uint32_t FetchQueue::queue(FetchJob job, FetchPriority priority, bool *added) {
+    *added = !_queued[job];
+
+    if (*added) {
+        _queued[job] = true;
+        _priority[job] = priority;
+        _queuedTicket[job] = ++_nextTicket;
+        _order[job] = _nextTicket;
+        _changed.notify_all();
+    } else if (priority > _priority[job]) {
+        _priority[job] = priority;
+    }
+
+    return _queuedTicket[job];
+}
+
+FetchJob FetchQueue::take() {
+    _mutex.lock();
+
+    while (true) {
+        int next = -1;
+        for (int i = 0; i < FetchJobCount; i++) {
+            if (!_queued[i]) {
+                continue;
+            }
+            if (next < 0 || _priority[i] > _priority[next] || (_priority[i] == _priority[next] && _order[i] < _order[next])) {
+                next = i;
+            }
+        }
+
+        if (next >= 0) {
+            _queued[next] = false;
+            _runningTicket[next] = _queuedTicket[next];
+            _mutex.unlock();
+            return static_cast<FetchJob>(next);
+        }
+
+        _changed.wait();
+    }
+}
+
+void FetchQueue::finish(FetchJob job, bool succeeded) {
+    _mutex.lock();
+    _finishedTicket[job] = _runningTicket[job];
+    _succeeded[job] = succeeded;
+    _changed.notify_all();
+    _mutex.unlock();
+}
+
+// The run keeps its ticket, so a waiter sees it finish when it runs again. If the job was queued again
+// while it ran, that newer run covers the waiters too
+void FetchQueue::retry(FetchJob job) {
+    _mutex.lock();
+    if (!_queued[job]) {
+        _queued[job] = true;
+        _queuedTicket[job] = _runningTicket[job];
+        _order[job] = _runningTicket[job];
+        _changed.notify_all();
+    }
+    _mutex.unlock();
+}
@@ -0,0 +1,98 @@
+/**
+ * @file   fetchStats.cpp
+ * @author Tobias Kallevik
+*/
+
+#include "fetchStats.h"
+#include <cstdio>
+
+const char *const fetchJobNames[FetchJobCount] = {"Time", "Clock", "Weather", "RSS"};
+const char *const timingPhaseNames[TimingPhaseCount] = {"dns", "connect", "tls", "first", "transfer", "total"};
+
+// Nearest rank percentile of a sorted list
+static int32_t percentile(const int32_t *sorted, int count, int percent) {
+    int rank = (percent * count + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+FetchStats::FetchStats() : _count(0) {
+}
+
+void FetchStats::record(FetchJob job, const RequestTiming &timing) {
+    _mutex.lock();
+    FetchRecord &record = _records[_count % FETCH_STATS_SIZE];
+    record.job = job;
+    record.succeeded = timing.result == 0 && timing.status < 400;
+    record.timing = timing;
+    _count++;
+    bool printSummary = _count % FETCH_STATS_PRINT_EVERY == 0;
+    _mutex.unlock();
+
+    printf("\n%s: dns %d connect %d tls %d first %d transfer %d total %d ms, %u B out %u B in, result %d status %d%s",
+           fetchJobNames[job], (int)timing.ms[TimingDns], (int)timing.ms[TimingConnect], (int)timing.ms[TimingTls],
+           (int)timing.ms[TimingFirstByte], (int)timing.ms[TimingTransfer], (int)timing.ms[TimingTotal],
+           (unsigned)timing.bytesSent, (unsigned)timing.bytesReceived, timing.result, timing.status, timing.reused ? " reused" : "");
+
+    if (printSummary) {
+        print();
+    }
+}
+
+bool FetchStats::summary(FetchJob job, FetchSummary *summary) const {
+    int32_t values[TimingPhaseCount][FETCH_STATS_SIZE];
+    int count = 0;
+    int failures = 0;
+
+    // Insertion sorts each phase while collecting, since the ring is small
+    _mutex.lock();
+    uint32_t stored = _count < FETCH_STATS_SIZE ? _count : FETCH_STATS_SIZE;
+    for (uint32_t i = 0; i < stored; i++) {
+        const FetchRecord &record = _records[i];
+        if (record.job != job) {
+            continue;
+        }
+
+        for (int phase = 0; phase < TimingPhaseCount; phase++) {
+            int32_t value = record.timing.ms[phase];
+            int j = count;
+            while (j > 0 && values[phase][j - 1] > value) {
+                values[phase][j] = values[phase][j - 1];
+                j--;
+            }
+            values[phase][j] = value;
+        }
+
+        failures += record.succeeded ? 0 : 1;
+        count++;
+    }
+    _mutex.unlock();
+
+    summary->count = count;
+    summary->failures = failures;
+    if (count == 0) {
+        return false;
+    }
+
+    for (int phase = 0; phase < TimingPhaseCount; phase++) {
+        summary->p50[phase] = percentile(values[phase], count, 50);
+        summary->p95[phase] = percentile(values[phase], count, 95);
+    }
+    return true;
+}
+
+void FetchStats::print() const {
+    printf("\nRecent requests, p50/p95 in ms:");
+
+    for (int job = 0; job < FetchJobCount; job++) {
+        FetchSummary summary;
+        if (!this->summary(static_cast<FetchJob>(job), &summary)) {
+            continue;
+        }
+
+        printf("\n%-8s n %2d fail %2d", fetchJobNames[job], summary.count, summary.failures);
+        for (int phase = 0; phase < TimingPhaseCount; phase++) {
+            printf("  %s %d/%d", timingPhaseNames[phase], (int)summary.p50[phase], (int)summary.p95[phase]);
+        }
+    }
+    printf("\n");
+}
@@ -0,0 +1,358 @@
+/**
+ * @file   httpClient.cpp
+ * @author Tobias Kallevik
+*/
+
+#include "httpClient.h"
+#include <cstdio>
+
+HttpRequest::HttpRequest(const char *method, const char *host, const string &path)
+    : _method(method), _host(host), _path(path) {
+}
+
+void HttpRequest::addHeader(const char *name, const string &value) {
+    _headers.push_back(make_pair(name, value));
+}
+
+// Builds the request string. Connection: close is left out so the server keeps the connection open
+string HttpRequest::build() const {
+    string request;
+    request.reserve(128);
+    request += _method;
+    request += " ";
+    request += _path;
+    request += " HTTP/1.1\r\nHost: ";
+    request += _host;
+    request += "\r\n";
+
+    for (size_t i = 0; i < _headers.size(); i++) {
+        request += _headers[i].first;
+        request += ": ";
+        request += _headers[i].second;
+        request += "\r\n";
+    }
+
+    request += "\r\n";
+    return request;
+}
+
+void HttpValidators::apply(HttpRequest *request) const {
+    if (path != request->path()) {
+        return;
+    }
+    if (!etag.empty()) {
+        request->addHeader("If-None-Match", etag);
+    }
+    if (!lastModified.empty()) {
+        request->addHeader("If-Modified-Since", lastModified);
+    }
+}
+
+void HttpValidators::store(const HttpRequest &request, const HttpResponse &response) {
+    // A 304 doesn't have to repeat the validators, so the old ones are kept. Those of an error page would
+    // make the server answer 304 to a request for data that was never received
+    if (response.status != 200) {
+        return;
+    }
+    path = request.path();
+    etag = response.etag;
+    lastModified = response.lastModified;
+}
+
+HttpClient::HttpClient() {
+}
+
+HttpClient::~HttpClient() {
+    closeAll();
+}
+
+void HttpClient::setNetwork(NetworkInterface *network, DnsCache *dns) {
+    _mutex.lock();
+    _network = network;
+    _dns = dns;
+    _mutex.unlock();
+}
+
+// Milliseconds from start until now, for the request timing
+static int32_t msSince(Kernel::Clock::time_point start) {
+    return duration_cast<milliseconds>(Kernel::Clock::now() - start).count();
+}
+
+// Sends a request, reusing the pooled connection to the host if there is one. If a reused connection
+// turns out to have been closed by the server, the request is sent again once on a new connection
+nsapi_error_t HttpClient::send(const HttpRequest &request, uint16_t port, HttpResponse *response,
+                               TlsContext *tls, HttpBodyHandler handler, void *context, RequestTiming *timing) {
+
+    RequestTiming unusedTiming;
+    if (timing == nullptr) {
+        timing = &unusedTiming;
+    }
+    *timing = RequestTiming();
+    Kernel::Clock::time_point start = Kernel::Clock::now();
+
+    string requestString = request.build();
+    nsapi_error_t result = NSAPI_ERROR_NO_CONNECTION;
+    *response = HttpResponse();
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        bool reused = false;
+
+        // Gets a connection to the host
+        HttpConnection *connection = acquire(request.host(), port, tls, &reused, &result, timing);
+        if (connection == nullptr) {
+            break;
+        }
+        timing->reused = reused;
+
+        // Sends the request
+        result = sendAll(connection, requestString.c_str(), requestString.size());
+        timing->bytesSent += requestString.size();
+
+        // Reads the response if the request was sent
+        bool complete = false;
+        *response = HttpResponse();
+        if (result == NSAPI_ERROR_OK) {
+            result = readResponse(connection, response, handler, context, &complete, timing);
+        }
+
+        // A stale keep-alive connection fails before any response is received. Tries again on a fresh connection
+        if (result != NSAPI_ERROR_OK && reused && response->status == 0) {
+            release(connection, false);
+            result = NSAPI_ERROR_NO_CONNECTION;
+            continue;
+        }
+
+        // The connection can only be reused if the whole response was read and the server allows it
+        if (result == NSAPI_ERROR_OK && complete && response->keepAlive) {
+            connection->expires = Kernel::Clock::now() + seconds(response->keepAliveTimeout - 1);
+            release(connection, true);
+        } else {
+            release(connection, false);
+        }
+        break;
+    }
+
+    timing->ms[TimingTotal] = msSince(start);
+    timing->result = result;
+    timing->status = response->status;
+    return result;
+}
+
+void HttpClient::closeAll() {
+    _mutex.lock();
+    for (int i = 0; i < HTTP_POOL_SIZE; i++) {
+        if (!_pool[i].inUse) {
+            closeConnection(&_pool[i]);
+        }
+    }
+    _mutex.unlock();
+}
+
+// Finds an open connection to the host or opens a new one
+HttpConnection *HttpClient::acquire(const char *host, uint16_t port, TlsContext *tls, bool *reused, nsapi_error_t *error, RequestTiming *timing) {
+
+    HttpConnection *connection = nullptr;
+    HttpConnection *freeSlot = nullptr;
+
+    _mutex.lock();
+
+    // Looks for a pooled connection to the same host and port
+    for (int i = 0; i < HTTP_POOL_SIZE; i++) {
+        if (_pool[i].inUse) {
+            continue;
+        }
+        if (_pool[i].socket != nullptr && _pool[i].port == port && strcmp(_pool[i].host, host) == 0) {
+            connection = &_pool[i];
+            break;
+        }
+        if (freeSlot == nullptr || freeSlot->socket != nullptr) {
+            freeSlot = &_pool[i];
+        }
+    }
+
+    // Closes the pooled connection if the server has most likely closed it already
+    if (connection != nullptr && connection->expires <= Kernel::Clock::now()) {
+        closeConnection(connection);
+    }
+
+    if (connection == nullptr) {
+        connection = freeSlot;
+    }
+
+    if (connection == nullptr) {
+        _mutex.unlock();
+        *error = NSAPI_ERROR_NO_MEMORY;
+        return nullptr;
+    }
+
+    connection->inUse = true;
+    NetworkInterface *network = _network;
+    _mutex.unlock();
+
+    if (connection->socket != nullptr) {
+        *reused = true;
+        return connection;
+    }
+
+    // Opens a new connection in the slot. Any other host using the slot is closed first
+    closeConnection(connection);
+    if (network == nullptr) {
+        connection->inUse = false;
+        *error = NSAPI_ERROR_NO_CONNECTION;
+        return nullptr;
+    }
+
+    *error = openConnection(connection, host, port, tls, timing);
+    if (*error != NSAPI_ERROR_OK) {
+        closeConnection(connection);
+        connection->inUse = false;
+        return nullptr;
+    }
+
+    *reused = false;
+    return connection;
+}
+
+// Returns the connection to the pool, closing it if it can't be reused
+void HttpClient::release(HttpConnection *connection, bool reusable) {
+    if (!reusable) {
+        closeConnection(connection);
+    }
+
+    _mutex.lock();
+    connection->inUse = false;
+    _mutex.unlock();
+}
+
+void HttpClient::closeConnection(HttpConnection *connection) {
+    if (connection->tls != nullptr) {
+        delete connection->tls;
+        connection->tls = nullptr;
+    }
+    if (connection->socket != nullptr) {
+        connection->socket->close();
+        delete connection->socket;
+        connection->socket = nullptr;
+    }
+    connection->host = nullptr;
+    connection->port = 0;
+    connection->expires = Kernel::Clock::time_point();
+}
+
+// Resolves the host and connects a TCP socket. If a TLS context is given, a TLS session is set up on top of it
+nsapi_error_t HttpClient::openConnection(HttpConnection *connection, const char *host, uint16_t port, TlsContext *tls, RequestTiming *timing) {
+
+    Kernel::Clock::time_point start = Kernel::Clock::now();
+    SocketAddress address;
+    nsapi_error_t result = _dns->resolve(host, &address);
+    timing->ms[TimingDns] = msSince(start);
+    if (result != NSAPI_ERROR_OK) {
+        return result;
+    }
+    address.set_port(port);
+
+    connection->host = host;
+    connection->port = port;
+    connection->socket = new TCPSocket;
+    connection->socket->open(_network);
+    connection->socket->set_timeout(HTTP_SOCKET_TIMEOUT);
+
+    start = Kernel::Clock::now();
+    result = connection->socket->connect(address);
+    timing->ms[TimingConnect] = msSince(start);
+    if (result != NSAPI_ERROR_OK) {
+        printf("\nFailed to connect to %s: %d", host, result);
+        // The host may have moved, so it is looked up again next time
+        _dns->invalidate(host);
+        return result;
+    }
+
+    if (tls != nullptr) {
+        start = Kernel::Clock::now();
+        connection->tls = new TlsStream(tls, connection->socket);
+        result = connection->tls->handshake(host);
+        timing->ms[TimingTls] = msSince(start);
+    }
+
+    return result;
+}
+
+nsapi_size_or_error_t HttpClient::transportSend(HttpConnection *connection, const void *data, nsapi_size_t length) {
+    if (connection->tls != nullptr) {
+        return connection->tls->send(data, length);
+    }
+    return connection->socket->send(data, length);
+}
+
+nsapi_size_or_error_t HttpClient::transportRecv(HttpConnection *connection, void *data, nsapi_size_t length) {
+    if (connection->tls != nullptr) {
+        return connection->tls->recv(data, length);
+    }
+    return connection->socket->recv(data, length);
+}
+
+// Sends the whole buffer, a chunk at a time
+nsapi_error_t HttpClient::sendAll(HttpConnection *connection, const char *data, size_t length) {
+    size_t bytesSent = 0;
+
+    while (bytesSent < length) {
+        nsapi_size_or_error_t result = transportSend(connection, data + bytesSent, length - bytesSent);
+        if (result < 0) {
+            return result;
+        }
+        bytesSent += result;
+    }
+
+    return NSAPI_ERROR_OK;
+}
+
+// Receives the response through a fixed buffer and lets the parser pass the body on as it arrives
+nsapi_error_t HttpClient::readResponse(HttpConnection *connection, HttpResponse *response, HttpBodyHandler handler, void *context, bool *complete, RequestTiming *timing) {
+
+    // Measured from here, right after the request was sent
+    Kernel::Clock::time_point sentAt = Kernel::Clock::now();
+    Kernel::Clock::time_point firstByteAt;
+
+    HttpResponseParser parser(response, handler, context);
+    _ring.clear();
+
+    while (true) {
+        // Receives straight into the ring. The parser always leaves room, since it only keeps the start of a short line
+        ByteSpan space = _ring.space();
+        nsapi_size_or_error_t result = transportRecv(connection, space.data, space.length);
+
+        // A close, or a timeout when the body has no length, ends a body that lasts until the connection closes
+        if (result == 0 || (result == NSAPI_ERROR_WOULD_BLOCK && parser.readsUntilClose())) {
+            if (!parser.closed()) {
+                return NSAPI_ERROR_CONNECTION_LOST;
+            }
+            break;
+        }
+        if (result < 0) {
+            return result;
+        }
+
+        if (timing->bytesReceived == 0) {
+            firstByteAt = Kernel::Clock::now();
+            timing->ms[TimingFirstByte] = duration_cast<milliseconds>(firstByteAt - sentAt).count();
+        }
+        timing->bytesReceived += result;
+
+        _ring.commit(result);
+        if (!parser.feed(&_ring)) {
+            break;
+        }
+    }
+
+    if (parser.failed()) {
+        return NSAPI_ERROR_DEVICE_ERROR;
+    }
+
+    if (timing->bytesReceived > 0) {
+        timing->ms[TimingTransfer] = msSince(firstByteAt);
+    }
+
+    // A body stopped by the handler is not read to the end, so the connection can't be reused
+    *complete = parser.done();
+    return NSAPI_ERROR_OK;
+}
@@ -0,0 +1,282 @@
+/**
+ * @file   httpResponseParser.cpp
+ * @author Tobias Kallevik
+*/
+
+#include "httpResponseParser.h"
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+// Compares a header name without case, since header names are case insensitive
+static bool nameIs(const char *line, size_t nameLength, const char *name) {
+    if (strlen(name) != nameLength) {
+        return false;
+    }
+    for (size_t i = 0; i < nameLength; i++) {
+        if (tolower((unsigned char)line[i]) != name[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Finds a word in a header value without case
+static bool valueHas(const char *value, const char *word) {
+    size_t length = strlen(word);
+    for (; *value != 0; value++) {
+        size_t i = 0;
+        while (i < length && tolower((unsigned char)value[i]) == word[i]) {
+            i++;
+        }
+        if (i == length) {
+            return true;
+        }
+    }
+    return false;
+}
+
+HttpResponseParser::HttpResponseParser(HttpResponse *response, HttpBodyHandler handler, void *context)
+    : _response(response), _handler(handler), _context(context),
+      _state(StatusLine), _headerSize(0), _remaining(0), _lineLength(0) {
+}
+
+bool HttpResponseParser::feed(RecvRing *ring) {
+    while (ring->size() > 0 && _state < Done) {
+        ByteSpan span = ring->front();
+
+        // Body bytes are passed on in place, the rest is read a line at a time
+        if (_state == Body || _state == ChunkData || _state == BodyUntilClose) {
+            size_t part = span.length;
+            if (_state != BodyUntilClose && _remaining < part) {
+                part = _remaining;
+            }
+
+            body(span.data, part);
+            ring->consume(part);
+            _remaining -= _state == BodyUntilClose ? 0 : part;
+
+            if (_state == Body && _remaining == 0) {
+                _state = Done;
+            } else if (_state == ChunkData && _remaining == 0) {
+                _state = ChunkDataEnd;
+            }
+            continue;
+        }
+
+        // The CRLF after the chunk data
+        if (_state == ChunkDataEnd) {
+            char c = span.data[0];
+            ring->consume(1);
+            if (c == '\n') {
+                _state = ChunkSize;
+            } else if (c != '\r') {
+                _state = Failed;
+            }
+            continue;
+        }
+
+        if (!line(ring)) {
+            break;
+        }
+    }
+
+    return _state < Done;
+}
+
+// Parses the next line if all of it has arrived. Returns false if the parser has to wait for more data
+bool HttpResponseParser::line(RecvRing *ring) {
+    ByteSpan span = ring->front();
+    char *newline = static_cast<char*>(memchr(span.data, '\n', span.length));
+    size_t used = newline != nullptr ? newline - span.data + 1 : span.length;
+
+    if (_state == StatusLine || _state == Header) {
+        _headerSize += used;
+        if (_headerSize > HTTP_MAX_HEADER_SIZE) {
+            _state = Failed;
+            return false;
+        }
+    }
+
+    if (newline == nullptr) {
+        // The rest of the line is waiting in the ring unless the line wraps around its end or is too long.
+        // Then the start of it is copied out, since the ring can't hold it in one piece
+        bool wraps = span.length < ring->size();
+        if (_lineLength == 0 && !wraps && span.length < HTTP_LINE_SIZE) {
+            if (_state == StatusLine || _state == Header) {
+                _headerSize -= used;
+            }
+            return false;
+        }
+
+        appendLine(span.data, span.length);
+        ring->consume(span.length);
+        return true;
+    }
+
+    // The line is ended in place, or added to the part copied out before
+    char *text = span.data;
+    size_t length = newline - span.data;
+    if (_lineLength > 0) {
+        appendLine(span.data, length);
+        text = _line;
+        length = _lineLength;
+    }
+    text[length] = 0;
+    if (length > 0 && text[length - 1] == '\r') {
+        text[--length] = 0;
+    }
+
+    switch (_state) {
+        case StatusLine:
+            statusLine(text);
+            break;
+        case Header:
+            headerLine(text, length);
+            break;
+        case ChunkSize:
+            chunkSizeLine(text);
+            break;
+        case Trailer:
+            trailerLine(length);
+            break;
+        default:
+            break;
+    }
+
+    _lineLength = 0;
+    ring->consume(used);
+    return true;
+}
+
+bool HttpResponseParser::closed() {
+    if (_state == BodyUntilClose) {
+        _state = Done;
+    }
+    return _state == Done;
+}
+
+// Adds to the part of the line copied out. Anything past the max line length is dropped
+void HttpResponseParser::appendLine(const char *data, size_t length) {
+    if (length > HTTP_LINE_SIZE - 1 - _lineLength) {
+        length = HTTP_LINE_SIZE - 1 - _lineLength;
+    }
+
+    memcpy(_line + _lineLength, data, length);
+    _lineLength += length;
+}
+
+// Parses the status line, for example "HTTP/1.1 200 OK"
+void HttpResponseParser::statusLine(const char *line) {
+    const char *space = strchr(line, ' ');
+    if (strncmp(line, "HTTP/", 5) != 0 || space == nullptr) {
+        _state = Failed;
+        return;
+    }
+
+    _response->status = atoi(space + 1);
+    _response->keepAlive = strncmp(line, "HTTP/1.0", 8) != 0;
+    _state = Header;
+}
+
+// Parses the header lines needed to know where the body ends and if the connection can be kept
+void HttpResponseParser::headerLine(const char *line, size_t length) {
+    if (length == 0) {
+        endHeader();
+        return;
+    }
+
+    const char *colon = strchr(line, ':');
+    if (colon == nullptr) {
+        return;
+    }
+
+    size_t nameLength = colon - line;
+    const char *value = colon + 1;
+    while (*value == ' ' || *value == '\t') {
+        value++;
+    }
+
+    if (nameIs(line, nameLength, "content-length")) {
+        _response->hasContentLength = true;
+        _response->contentLength = strtoul(value, nullptr, 10);
+    } else if (nameIs(line, nameLength, "transfer-encoding")) {
+        _response->chunked = valueHas(value, "chunked");
+    } else if (nameIs(line, nameLength, "connection")) {
+        _response->keepAlive = !valueHas(value, "close");
+    } else if (nameIs(line, nameLength, "content-encoding")) {
+        _response->gzip = valueHas(value, "gzip");
+    } else if (nameIs(line, nameLength, "etag")) {
+        _response->etag = value;
+    } else if (nameIs(line, nameLength, "last-modified")) {
+        _response->lastModified = value;
+    } else if (nameIs(line, nameLength, "keep-alive")) {
+        const char *timeout = strstr(value, "timeout=");
+        if (timeout != nullptr) {
+            _response->keepAliveTimeout = atoi(timeout + 8);
+        }
+    }
+}
+
+// Decides how the body is read once the blank line after the header arrives
+void HttpResponseParser::endHeader() {
+    int status = _response->status;
+
+    // An informational response is followed by the real one
+    if (status / 100 == 1) {
+        *_response = HttpResponse();
+        _headerSize = 0;
+        _state = StatusLine;
+        return;
+    }
+
+    // These responses never have a body
+    if (status == 204 || status == 304) {
+        _response->hasContentLength = true;
+        _response->contentLength = 0;
+        _response->chunked = false;
+    }
+
+    // Chunked encoding wins over a length, as the HTTP/1.1 specification says
+    if (_response->chunked) {
+        _response->hasContentLength = false;
+        _state = ChunkSize;
+    } else if (_response->hasContentLength) {
+        _remaining = _response->contentLength;
+        _state = _remaining > 0 ? Body : Done;
+    } else {
+        // Without a length the body ends when the server closes, so the connection can't be reused
+        _response->keepAlive = false;
+        _state = BodyUntilClose;
+    }
+}
+
+// Parses the size line before each chunk. Chunk extensions after ';' are ignored. The last chunk has size 0
+void HttpResponseParser::chunkSizeLine(const char *line) {
+    char *end;
+    unsigned long size = strtoul(line, &end, 16);
+    if (end == line) {
+        _state = Failed;
+        return;
+    }
+
+    _remaining = size;
+    _state = size > 0 ? ChunkData : Trailer;
+}
+
+// Skips any trailer headers after the last chunk. The response ends with a blank line
+void HttpResponseParser::trailerLine(size_t length) {
+    if (length == 0) {
+        _state = Done;
+    }
+}
+
+void HttpResponseParser::body(const char *data, size_t length) {
+    _response->bodyLength += length;
+
+    if (_handler == nullptr) {
+        _response->body.append(data, length);
+    } else if (!_handler(_context, data, length)) {
+        _state = Stopped;
+    }
+}
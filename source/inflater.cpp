@@ -0,0 +1,555 @@
+/**
+ * @file   inflater.cpp
+ * @author Tobias Kallevik
+*/
+
+#include "inflater.h"
+#include "crc32.h"
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+// Base lengths and distances of the length and distance symbols, and the extra bits added to them (RFC 1951 3.2.5)
+static const uint16_t lengthBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t lengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t distanceBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+    4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t distanceExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+// Order the code length code lengths are sent in
+static const uint8_t codeLengthOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// Returned by decode when the code goes past the bits read so far, or matches no symbol
+#define DECODE_MORE -1
+#define DECODE_ERROR -2
+
+// Builds a canonical Huffman table from the code length of each symbol. Returns false if the lengths
+// give more codes than there is room for
+static bool buildTable(uint16_t *counts, uint16_t *symbols, const uint8_t *lengths, int n) {
+    uint16_t offsets[INFLATE_MAX_BITS + 1];
+
+    memset(counts, 0, (INFLATE_MAX_BITS + 1) * sizeof(counts[0]));
+    for (int i = 0; i < n; i++) {
+        counts[lengths[i]]++;
+    }
+
+    int left = 1;
+    for (int length = 1; length <= INFLATE_MAX_BITS; length++) {
+        left = (left << 1) - counts[length];
+        if (left < 0) {
+            return false;
+        }
+    }
+
+    offsets[1] = 0;
+    for (int length = 1; length < INFLATE_MAX_BITS; length++) {
+        offsets[length + 1] = offsets[length] + counts[length];
+    }
+    for (int i = 0; i < n; i++) {
+        if (lengths[i] != 0) {
+            symbols[offsets[lengths[i]]++] = i;
+        }
+    }
+
+    return true;
+}
+
+Inflater::Inflater() : _window(nullptr), _position(0), _flushed(0), _state(Failed), _final(false), _bits(0), _bitCount(0) {
+}
+
+Inflater::~Inflater() {
+    delete[] _window;
+}
+
+bool Inflater::init() {
+    if (_window == nullptr) {
+        _window = new (std::nothrow) uint8_t[INFLATE_WINDOW_SIZE];
+    }
+
+    _position = 0;
+    _flushed = 0;
+    _final = false;
+    _bits = 0;
+    _bitCount = 0;
+    _state = _window != nullptr ? BlockHeader : Failed;
+    return _window != nullptr;
+}
+
+InflateResult Inflater::feed(const uint8_t *data, size_t length, size_t *used, HttpBodyHandler handler, void *context) {
+    _in = data;
+    _inEnd = data + length;
+    _handler = handler;
+    _context = context;
+
+    // What was decoded is passed on before returning, so the handler sees the data without waiting for the next part
+    InflateResult result = run();
+    if ((result == InflateMore || result == InflateDone) && !flush()) {
+        result = InflateStopped;
+    }
+
+    *used = _in - data;
+    return result;
+}
+
+size_t Inflater::leftover(uint8_t *bytes) {
+    take(_bitCount % 8);
+
+    size_t count = 0;
+    while (_bitCount >= 8) {
+        bytes[count++] = take(8);
+    }
+
+    return count;
+}
+
+// Reads input until count bits are waiting. Returns false if the input ran out first
+bool Inflater::need(int count) {
+    while (_bitCount < count) {
+        if (_in == _inEnd) {
+            return false;
+        }
+        _bits |= (uint64_t)*_in++ << _bitCount;
+        _bitCount += 8;
+    }
+
+    return true;
+}
+
+uint32_t Inflater::take(int count) {
+    uint32_t value = _bits & ((1u << count) - 1);
+    _bits >>= count;
+    _bitCount -= count;
+    return value;
+}
+
+// Finds the next symbol without using its bits, so it can be tried again once more input has arrived.
+// Huffman codes are sent from their top bit, so the code is built one bit at a time and compared
+// against the first code of each length
+int Inflater::decode(const uint16_t *counts, const uint16_t *symbols, int *length) {
+    need(INFLATE_MAX_BITS);
+
+    int code = 0;
+    int first = 0;
+    int index = 0;
+
+    for (int bits = 1; bits <= INFLATE_MAX_BITS; bits++) {
+        if (bits > _bitCount) {
+            return DECODE_MORE;
+        }
+
+        code |= (_bits >> (bits - 1)) & 1;
+        int count = counts[bits];
+        if (code - first < count) {
+            *length = bits;
+            return symbols[index + code - first];
+        }
+
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+
+    return DECODE_ERROR;
+}
+
+// Adds a byte to the window. The window is passed on before it wraps around and overwrites what wasn't
+bool Inflater::put(uint8_t byte) {
+    _window[_position % INFLATE_WINDOW_SIZE] = byte;
+    _position++;
+
+    if (_position % INFLATE_WINDOW_SIZE == 0 && !flush()) {
+        _state = Stopped;
+        return false;
+    }
+
+    return true;
+}
+
+bool Inflater::flush() {
+    if (_position == _flushed) {
+        return true;
+    }
+
+    const char *start = reinterpret_cast<const char*>(_window) + _flushed % INFLATE_WINDOW_SIZE;
+    size_t length = _position - _flushed;
+    _flushed = _position;
+    return _handler(_context, start, length);
+}
+
+// The fixed codes of RFC 1951 3.2.6
+void Inflater::fixedTables() {
+    for (int i = 0; i < INFLATE_LIT_CODES; i++) {
+        _lengths[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+    }
+    buildTable(_litCounts, _litSymbols, _lengths, INFLATE_LIT_CODES);
+
+    for (int i = 0; i < 30; i++) {
+        _lengths[i] = 5;
+    }
+    buildTable(_distCounts, _distSymbols, _lengths, 30);
+}
+
+// Decodes as far as the input goes. Every state only uses its bits once all of them have arrived, so
+// it can stop at any point and go on from there in the next feed call
+InflateResult Inflater::run() {
+    int length;
+    int symbol;
+    int extra;
+
+    while (true) {
+        switch (_state) {
+            case BlockHeader:
+                if (_final) {
+                    _state = Done;
+                    break;
+                }
+                if (!need(3)) {
+                    return InflateMore;
+                }
+
+                _final = take(1);
+                switch (take(2)) {
+                    case 0:
+                        // Stored blocks start at a whole byte
+                        take(_bitCount % 8);
+                        _state = StoredLength;
+                        break;
+                    case 1:
+                        fixedTables();
+                        _state = Codes;
+                        break;
+                    case 2:
+                        _state = TableSizes;
+                        break;
+                    default:
+                        _state = Failed;
+                        break;
+                }
+                break;
+
+            case StoredLength: {
+                if (!need(32)) {
+                    return InflateMore;
+                }
+                uint32_t storedLength = take(16);
+                if (storedLength != (~take(16) & 0xFFFF)) {
+                    _state = Failed;
+                    break;
+                }
+                _remaining = storedLength;
+                _state = Stored;
+                break;
+            }
+
+            case Stored:
+                while (_remaining > 0) {
+                    if (!need(8)) {
+                        return InflateMore;
+                    }
+                    _remaining--;
+                    if (!put(take(8))) {
+                        return InflateStopped;
+                    }
+                }
+                _state = BlockHeader;
+                break;
+
+            case TableSizes:
+                if (!need(14)) {
+                    return InflateMore;
+                }
+                _litCount = take(5) + 257;
+                _distCount = take(5) + 1;
+                _codeLengthCount = take(4) + 4;
+                if (_litCount > 286 || _distCount > 30) {
+                    _state = Failed;
+                    break;
+                }
+                memset(_lengths, 0, 19);
+                _index = 0;
+                _state = CodeLengthCodes;
+                break;
+
+            case CodeLengthCodes:
+                while (_index < _codeLengthCount) {
+                    if (!need(3)) {
+                        return InflateMore;
+                    }
+                    _lengths[codeLengthOrder[_index++]] = take(3);
+                }
+                if (!buildTable(_distCounts, _distSymbols, _lengths, 19)) {
+                    _state = Failed;
+                    break;
+                }
+                _index = 0;
+                _state = CodeLengths;
+                break;
+
+            case CodeLengths:
+                while (_index < _litCount + _distCount) {
+                    symbol = decode(_distCounts, _distSymbols, &length);
+                    if (symbol == DECODE_MORE) {
+                        return InflateMore;
+                    }
+                    if (symbol == DECODE_ERROR) {
+                        _state = Failed;
+                        break;
+                    }
+                    if (symbol < 16) {
+                        take(length);
+                        _lengths[_index++] = symbol;
+                        continue;
+                    }
+
+                    // 16 repeats the last length 3-6 times, 17 and 18 repeat zero 3-10 and 11-138 times
+                    extra = symbol == 16 ? 2 : symbol == 17 ? 3 : 7;
+                    if (!need(length + extra)) {
+                        return InflateMore;
+                    }
+                    take(length);
+                    int repeat = take(extra) + (symbol == 18 ? 11 : 3);
+                    if ((symbol == 16 && _index == 0) || _index + repeat > _litCount + _distCount) {
+                        _state = Failed;
+                        break;
+                    }
+                    uint8_t value = symbol == 16 ? _lengths[_index - 1] : 0;
+                    while (repeat-- > 0) {
+                        _lengths[_index++] = value;
+                    }
+                }
+                if (_state == Failed) {
+                    break;
+                }
+
+                // The block can't end without a code for the end of block symbol
+                if (_lengths[256] == 0 || !buildTable(_litCounts, _litSymbols, _lengths, _litCount)
+                    || !buildTable(_distCounts, _distSymbols, _lengths + _litCount, _distCount)) {
+                    _state = Failed;
+                    break;
+                }
+                _state = Codes;
+                break;
+
+            case Codes:
+                symbol = decode(_litCounts, _litSymbols, &length);
+                if (symbol == DECODE_MORE) {
+                    return InflateMore;
+                }
+                if (symbol == DECODE_ERROR || symbol > 285) {
+                    _state = Failed;
+                    break;
+                }
+
+                if (symbol < 256) {
+                    take(length);
+                    if (!put(symbol)) {
+                        return InflateStopped;
+                    }
+                } else if (symbol == 256) {
+                    take(length);
+                    _state = BlockHeader;
+                } else {
+                    symbol -= 257;
+                    if (!need(length + lengthExtra[symbol])) {
+                        return InflateMore;
+                    }
+                    take(length);
+                    _length = lengthBase[symbol] + take(lengthExtra[symbol]);
+                    _state = Distance;
+                }
+                break;
+
+            case Distance:
+                symbol = decode(_distCounts, _distSymbols, &length);
+                if (symbol == DECODE_MORE) {
+                    return InflateMore;
+                }
+                if (symbol == DECODE_ERROR || symbol >= 30) {
+                    _state = Failed;
+                    break;
+                }
+                if (!need(length + distanceExtra[symbol])) {
+                    return InflateMore;
+                }
+                take(length);
+                _distance = distanceBase[symbol] + take(distanceExtra[symbol]);
+
+                // A match can't reach back before the start of the stream
+                if (_distance > _position) {
+                    _state = Failed;
+                    break;
+                }
+                _state = Copy;
+                break;
+
+            case Copy:
+                while (_length > 0) {
+                    _length--;
+                    if (!put(_window[(_position - _distance) % INFLATE_WINDOW_SIZE])) {
+                        return InflateStopped;
+                    }
+                }
+                _state = Codes;
+                break;
+
+            case Done:
+                return InflateDone;
+
+            case Stopped:
+                return InflateStopped;
+
+            case Failed:
+                return InflateError;
+        }
+    }
+}
+
+// Flags in the gzip header (RFC 1952 2.3.1)
+#define GZIP_FHCRC 0x02
+#define GZIP_FEXTRA 0x04
+#define GZIP_FNAME 0x08
+#define GZIP_FCOMMENT 0x10
+
+// Length of the fixed part of the gzip header
+#define GZIP_HEADER_SIZE 10
+
+GzipDecoder::GzipDecoder(HttpBodyHandler handler, void *context)
+    : _handler(handler), _context(context), _state(Header), _flags(0), _count(0), _extraLength(0), _crc(0), _size(0) {
+}
+
+bool GzipDecoder::feed(const char *data, size_t length) {
+    const uint8_t *bytes = reinterpret_cast<const uint8_t*>(data);
+    size_t i = 0;
+
+    while (i < length && _state != Stopped && _state != Failed) {
+        if (_state != Body) {
+            headerByte(bytes[i++]);
+            continue;
+        }
+
+        size_t used;
+        InflateResult result = _inflater.feed(bytes + i, length - i, &used, output, this);
+        i += used;
+
+        if (result == InflateError) {
+            printf("\nBroken gzip data");
+            _state = Failed;
+        } else if (result == InflateStopped) {
+            _state = Stopped;
+        } else if (result == InflateDone) {
+            // The inflater may have read into the trailer
+            uint8_t leftover[8];
+            size_t count = _inflater.leftover(leftover);
+            _state = Trailer;
+            _count = 0;
+            for (size_t j = 0; j < count; j++) {
+                headerByte(leftover[j]);
+            }
+        }
+    }
+
+    return _state != Stopped && _state != Failed;
+}
+
+// Parses the header and the trailer around the deflate data one byte at a time
+bool GzipDecoder::headerByte(uint8_t byte) {
+    switch (_state) {
+        case Header:
+            // ID1, ID2 and the deflate method, then the flags. The time, extra flags and OS are skipped
+            if ((_count == 0 && byte != 0x1F) || (_count == 1 && byte != 0x8B) || (_count == 2 && byte != 8)) {
+                printf("\nNot gzip data");
+                _state = Failed;
+                return false;
+            }
+            if (_count == 3) {
+                _flags = byte;
+            }
+            if (++_count == GZIP_HEADER_SIZE) {
+                nextField();
+            }
+            break;
+
+        case ExtraLength:
+            _extraLength |= (uint32_t)byte << (8 * _count);
+            if (++_count == 2) {
+                _state = Extra;
+                _count = 0;
+                if (_extraLength == 0) {
+                    nextField();
+                }
+            }
+            break;
+
+        case Extra:
+            if (++_count == _extraLength) {
+                nextField();
+            }
+            break;
+
+        case Name:
+        case Comment:
+            if (byte == 0) {
+                nextField();
+            }
+            break;
+
+        case HeaderCrc:
+            if (++_count == 2) {
+                nextField();
+            }
+            break;
+
+        case Trailer:
+            _trailer[_count++] = byte;
+            if (_count == sizeof(_trailer)) {
+                uint32_t crc = _trailer[0] | _trailer[1] << 8 | _trailer[2] << 16 | (uint32_t)_trailer[3] << 24;
+                uint32_t size = _trailer[4] | _trailer[5] << 8 | _trailer[6] << 16 | (uint32_t)_trailer[7] << 24;
+                if (crc != _crc || size != _size) {
+                    printf("\nGzip data failed its check");
+                    _state = Failed;
+                    return false;
+                }
+                _state = Done;
+            }
+            break;
+
+        // Anything after the first member is ignored
+        default:
+            break;
+    }
+
+    return true;
+}
+
+// Moves on to the next optional header field that is present, in the order they are sent, or to the data
+void GzipDecoder::nextField() {
+    _count = 0;
+
+    if (_state < ExtraLength && (_flags & GZIP_FEXTRA)) {
+        _state = ExtraLength;
+    } else if (_state < Name && (_flags & GZIP_FNAME)) {
+        _state = Name;
+    } else if (_state < Comment && (_flags & GZIP_FCOMMENT)) {
+        _state = Comment;
+    } else if (_state < HeaderCrc && (_flags & GZIP_FHCRC)) {
+        _state = HeaderCrc;
+    } else {
+        _state = Body;
+    }
+}
+
+// Checks the decoded data against the trailer as it passes through
+bool GzipDecoder::output(void *context, const char *data, size_t length) {
+    GzipDecoder *decoder = static_cast<GzipDecoder*>(context);
+    decoder->_crc = crc32(data, length, decoder->_crc);
+    decoder->_size += length;
+    return decoder->_handler(decoder->_context, data, length);
+}
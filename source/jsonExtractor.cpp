@@ -0,0 +1,321 @@
+/**
+ * @file   jsonExtractor.cpp
+ * @author Tobias Kallevik
+*/
+
+#include "jsonExtractor.h"
+#include <cstring>
+
+// True for the whitespace allowed between JSON tokens
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Converts a hex digit, returns -1 if the char isn't one
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+JsonExtractor::JsonExtractor(JsonField *fields, size_t fieldCount) : _fields(fields), _fieldCount(fieldCount) {
+    reset();
+}
+
+void JsonExtractor::reset() {
+    _state = WaitForDocument;
+    _readingKey = false;
+    _depth = 0;
+    _objectBits = 0;
+    _path[0] = 0;
+    _pathLength = 0;
+    _pathOverflow = false;
+    _capture = nullptr;
+    _captureLength = 0;
+    _unicode = 0;
+    _unicodeDigits = 0;
+
+    for (size_t i = 0; i < _fieldCount; i++) {
+        _fields[i].value[0] = 0;
+        _fields[i].found = false;
+    }
+}
+
+bool JsonExtractor::feed(const char *data, size_t length) {
+    for (size_t i = 0; i < length && _state != Done && _state != Failed; i++) {
+        step(data[i]);
+    }
+    return _state != Failed;
+}
+
+bool JsonExtractor::foundAll() const {
+    for (size_t i = 0; i < _fieldCount; i++) {
+        if (!_fields[i].found) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const char *JsonExtractor::value(const char *path) const {
+    for (size_t i = 0; i < _fieldCount; i++) {
+        if (_fields[i].found && strcmp(_fields[i].path, path) == 0) {
+            return _fields[i].value;
+        }
+    }
+    return nullptr;
+}
+
+// Runs one char through the state machine
+void JsonExtractor::step(char c) {
+    switch (_state) {
+        // Skips anything in front of the document
+        case WaitForDocument:
+            if (c == '{' || c == '[') {
+                push(c == '{');
+            }
+            break;
+
+        // Right after '{', either the first key or the end of an empty object
+        case KeyOrEnd:
+            if (isSpace(c)) break;
+            if (c == '}') {
+                pop(c);
+            } else if (c == '"') {
+                _readingKey = true;
+                beginSegment();
+                _state = String;
+            } else {
+                _state = Failed;
+            }
+            break;
+
+        // After a ',' in an object
+        case Key:
+            if (isSpace(c)) break;
+            if (c == '"') {
+                _readingKey = true;
+                beginSegment();
+                _state = String;
+            } else {
+                _state = Failed;
+            }
+            break;
+
+        case Colon:
+            if (isSpace(c)) break;
+            _state = c == ':' ? Value : Failed;
+            break;
+
+        // Right after '[', either the first element or the end of an empty array
+        case ValueOrEnd:
+            if (isSpace(c)) break;
+            if (c == ']') {
+                pop(c);
+                break;
+            }
+            beginSegment();
+            _state = Value;
+            step(c);
+            break;
+
+        case Value:
+            if (isSpace(c)) break;
+            if (c == '{' || c == '[') {
+                push(c == '{');
+            } else if (c == '"') {
+                beginValue();
+                _state = String;
+            } else if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n') {
+                beginValue();
+                _state = Literal;
+                stringChar(c);
+            } else {
+                _state = Failed;
+            }
+            break;
+
+        case String:
+            if (c == '\\') {
+                _state = Escape;
+            } else if (c == '"') {
+                if (_readingKey) {
+                    _readingKey = false;
+                    _state = Colon;
+                } else {
+                    endValue();
+                    _state = AfterValue;
+                }
+            } else {
+                stringChar(c);
+            }
+            break;
+
+        case Escape:
+            _state = String;
+            switch (c) {
+                case 'b': stringChar('\b'); break;
+                case 'f': stringChar('\f'); break;
+                case 'n': stringChar('\n'); break;
+                case 'r': stringChar('\r'); break;
+                case 't': stringChar('\t'); break;
+                case 'u':
+                    _unicode = 0;
+                    _unicodeDigits = 0;
+                    _state = Unicode;
+                    break;
+                default: stringChar(c); break;
+            }
+            break;
+
+        // Reads the 4 hex digits of a \u escape. The display only shows ASCII, so anything else becomes '?'
+        case Unicode: {
+            int digit = hexValue(c);
+            if (digit < 0) {
+                _state = Failed;
+                break;
+            }
+            _unicode = (_unicode << 4) | digit;
+            if (++_unicodeDigits == 4) {
+                stringChar(_unicode < 0x80 ? (char)_unicode : '?');
+                _state = String;
+            }
+            break;
+        }
+
+        // Numbers, true, false and null end at the first char that can't be part of them
+        case Literal:
+            if (isSpace(c) || c == ',' || c == '}' || c == ']') {
+                endValue();
+                _state = AfterValue;
+                step(c);
+            } else {
+                stringChar(c);
+            }
+            break;
+
+        case AfterValue:
+            if (isSpace(c)) break;
+            if (c == ',') {
+                if (inObject()) {
+                    _state = Key;
+                } else {
+                    beginSegment();
+                    _state = Value;
+                }
+            } else if (c == '}' || c == ']') {
+                pop(c);
+            } else {
+                _state = Failed;
+            }
+            break;
+
+        case Done:
+        case Failed:
+            break;
+    }
+}
+
+// Adds a char to the key being read or to the value being captured
+void JsonExtractor::stringChar(char c) {
+    if (_readingKey) {
+        appendPath(c);
+    } else if (_capture != nullptr && _captureLength < JSON_VALUE_SIZE - 1) {
+        _capture->value[_captureLength++] = c;
+    }
+}
+
+// Starts capturing the value if its path is one of the wanted ones
+void JsonExtractor::beginValue() {
+    _capture = nullptr;
+    _captureLength = 0;
+
+    if (_pathOverflow || _depth > JSON_MAX_PATH_DEPTH) {
+        return;
+    }
+
+    _path[_pathLength] = 0;
+    for (size_t i = 0; i < _fieldCount; i++) {
+        if (strcmp(_fields[i].path, _path) == 0) {
+            _capture = &_fields[i];
+            return;
+        }
+    }
+}
+
+void JsonExtractor::endValue() {
+    if (_capture != nullptr) {
+        _capture->value[_captureLength] = 0;
+        _capture->found = true;
+        _capture = nullptr;
+    }
+}
+
+// Opens an object or array. Its path is the path of the key or element it belongs to
+void JsonExtractor::push(bool object) {
+    if (_depth >= JSON_MAX_DEPTH) {
+        _state = Failed;
+        return;
+    }
+
+    _depth++;
+    if (object) {
+        _objectBits |= 1u << (_depth - 1);
+    } else {
+        _objectBits &= ~(1u << (_depth - 1));
+    }
+
+    if (_depth <= JSON_MAX_PATH_DEPTH) {
+        _segmentStart[_depth] = _pathLength;
+        _segmentOverflow[_depth] = _pathOverflow;
+    }
+
+    _state = object ? KeyOrEnd : ValueOrEnd;
+}
+
+// Closes an object or array. The closing bracket has to match the one that opened it
+void JsonExtractor::pop(char c) {
+    if ((c == '}') != inObject()) {
+        _state = Failed;
+        return;
+    }
+
+    if (_depth <= JSON_MAX_PATH_DEPTH) {
+        _pathLength = _segmentStart[_depth];
+        _pathOverflow = _segmentOverflow[_depth];
+    }
+
+    _depth--;
+    _state = _depth == 0 ? Done : AfterValue;
+}
+
+// Cuts the path back to the current container before a new key or array element is added
+void JsonExtractor::beginSegment() {
+    if (_depth > JSON_MAX_PATH_DEPTH) {
+        return;
+    }
+
+    _pathLength = _segmentStart[_depth];
+    _pathOverflow = _segmentOverflow[_depth];
+
+    if (inObject()) {
+        if (_pathLength > 0) {
+            appendPath('.');
+        }
+    } else {
+        appendPath('[');
+        appendPath(']');
+    }
+}
+
+void JsonExtractor::appendPath(char c) {
+    if (_depth > JSON_MAX_PATH_DEPTH) {
+        return;
+    }
+    if (_pathLength < JSON_PATH_SIZE - 1) {
+        _path[_pathLength++] = c;
+    } else {
+        _pathOverflow = true;
+    }
+}
@@ -8,7 +8,7 @@
 #include "mbed.h"
 #include "time.h"
 #include "rtos.h"
-#include "DFRobot_RGBLCD.h"
+#include "displayService.h"
 #include "HTS221Sensor.h"
 #include <algorithm>
 #include <cstdint>
@@ -22,6 +22,8 @@
 #include "apiThreads.h"
 #include "screens.h"
 #include "utilities.h"
+#include "ipgeolocation_ca_certificate.h"
+#include "bootSequence.h"
 
 // Gets pointer to default network instance
 NetworkInterface *network = NetworkInterface::get_default_instance(); 
@@ -36,8 +38,9 @@ InterruptIn interrupt5(D4);
 PwmOut buzzer(D12);
 AnalogIn pot(A0);
 
-// Creates instances for connected devices
-DFRobot_RGBLCD lcd(16, 2, D14, D15);
+// Creates instances for connected devices. The LCD belongs to the display thread, and the screens draw on the canvas
+DisplayService display(16, 2, D14, D15);
+LcdCanvas lcd(&display);
 DevI2C *i2c = new DevI2C(PB_11, PB_10);
 HTS221Sensor hts221(i2c, HTS221_I2C_ADDRESS, PA_0);
 
@@ -47,10 +50,8 @@ AlarmData alarmData;
 SystemTimeData systemTimeData;
 ChangeLocationData changeLocationData;
 
-// Threads
-Thread timeThread;
-Thread weatherThread;
-Thread rssThread;
+// Threads. All fetches run on the network thread
+Thread networkThread(osPriorityNormal, MBED_CONF_APP_NETWORK_THREAD_STACK_SIZE, nullptr, "network");
 Thread systemTimeThread;
 
 // Interrupt Flags and interrupt vaiables
@@ -62,7 +63,7 @@ int menuState = 0;
 void interrupt1Func() {
     wait_us(50000);
 
-    if (menuState < 4) {
+    if (menuState < 5) {
         menuState++;
         menuSwitched = true;
     } 
@@ -114,6 +115,78 @@ void interrupt5Func() {
     }
 }
 
+// Boot stages, run by the boot sequence in main
+// Whether the boot screens can show the data cached in flash instead of waiting for the time fetch
+bool bootFromCache = false;
+
+// Connects to the network. Can take many seconds, so it runs alongside the other stages
+void connectStage() {
+    connectToNetwork(&sharedData);
+}
+
+// Starts the display thread, which sets up the LCD
+void lcdStage() {
+    display.start(MBED_CONF_APP_LCD_CONSERVATIVE_TIMING);
+    lcd.clear();
+    lcd.printf("STARTING DEVICE");
+    lcd.submit();
+}
+
+// Parses the CA certificate once. Every later time fetch reuses it
+void tlsStage() {
+    sharedData.ipgeolocationTls.init(ipgeolocation_ca_certificate);
+}
+
+// Sets up the temperature and humidity sensor
+void sensorStage() {
+    hts221.init(NULL);
+    hts221.enable();
+}
+
+// Publishes the data saved before the last reset. It can be shown right away if the RTC kept running
+void cacheStage() {
+    bootFromCache = loadCachedData(&sharedData) && time(NULL) > RTC_VALID_AFTER;
+}
+
+// Starts the thread that runs all fetches. Needs the network and the certificate
+void networkStage() {
+    networkThread.start(callback(networkThreadFunc, (void *)&sharedData));
+}
+
+// Waits until the time has been fetched, unless the cached data is used. The other fetches rely on the data gotten from it.
+// The fetch is queued until the network thread has started
+void timeStage() {
+    if (bootFromCache) {
+        printf("\nUsing cached data");
+        return;
+    }
+
+    while (!sharedData.fetchQueue.requestAndWait(FetchTime, PriorityUser)) {
+        thread_sleep_for(1000);
+    }
+}
+
+// Starts the thread for setting system time, and declares how fresh each source must be kept so the scheduler
+// fetches the rest of the data while the bootup screens show. With cached data the clock is fetched first
+void clockStage() {
+    systemTimeData.clockDiscipline = &sharedData.clockDiscipline;
+    systemTimeThread.start(callback(systemTimeThreadFunc, (void *)&systemTimeData));
+
+    int clockInterval = sharedData.clockDiscipline.syncInterval();
+    sharedData.refresh.configure(FetchClock, clockInterval, clockInterval, CLOCK_MIN_INTERVAL);
+    sharedData.refresh.configure(FetchWeather, WEATHER_FRESHNESS, WEATHER_VISIBLE_FRESHNESS, WEATHER_MIN_INTERVAL);
+    sharedData.refresh.configure(FetchRss, RSS_FRESHNESS, RSS_VISIBLE_FRESHNESS, RSS_MIN_INTERVAL);
+    if (!bootFromCache) {
+        sharedData.refresh.fetched(FetchClock, true);
+    }
+    sharedData.refresh.poll(&sharedData.fetchQueue, sharedData.fetchHealth);
+}
+
+// Calls the bootup function to display the bootup screens
+void screensStage() {
+    bootUp(&sharedData, &lcd);
+}
+
 // Main function
 int main()
 {
@@ -124,32 +197,19 @@ int main()
     interrupt4.rise(&interrupt4Func);
     interrupt5.rise(&interrupt5Func);
 
-    // Sets up LCD, sensor and timer
-    lcd.init();
-    lcd.clear();
-    hts221.init(NULL);
-    hts221.enable();
-
-    string rssFeed;
-
-    // Starts and runs different bootup function and threads. The threads needs to be started in a specific oreder to ensure that data is available when needed
-    // Connect to newtork
-    lcd.printf("STARTING DEVICE"); 
-    connectToNetwork(&sharedData); 
-    // Starts the time api thread, singals the thread to unblock and waits until the time API thread unblocks the main thread. This is done since other threads rely on the data in this gotten from this thread
-    timeThread.start(callback(timeThreadFunc, (void *)&sharedData)); 
-    sharedData.timeThreadFlag.set(timeFlagBtn);
-    sharedData.mainThreadFlag.wait_all(mainFlagBtn);
-    // Starts the thread for setting system time
-    systemTimeThread.start(callback(systemTimeThreadFunc, (void *)&systemTimeData));
-    // Starts and unblocks the other threads
-    weatherThread.start(callback(weatherThreadFunc, (void *)&sharedData)); 
-    sharedData.weatherThreadFlag.set(weatherFlagBtn); 
-    rssThread.start(callback(rssThreadFunc, (void *)&sharedData)); 
-    sharedData.rssThreadFlag.set(rssFlagBtn); 
-    
-    // Calls the bootup function to display the bootup screens
-    bootUp(&sharedData, &lcd);
+    // Runs the boot stages, each as soon as the stages it needs are done. The LCD, sensor and certificate are set up while the Wi-Fi module associates
+    BootSequence boot;
+    uint32_t wifi = boot.add("wifi", connectStage);
+    uint32_t lcdReady = boot.add("lcd", lcdStage);
+    uint32_t tls = boot.add("tls", tlsStage);
+    boot.add("sensor", sensorStage);
+    uint32_t cache = boot.add("cache", cacheStage);
+    boot.add("network", networkStage, wifi | tls);
+    uint32_t timeFetched = boot.add("time", timeStage, cache);
+    boot.add("clock", clockStage, timeFetched);
+    boot.add("screens", screensStage, lcdReady | timeFetched);
+    boot.run();
+    boot.printTimes();
     lcd.clear();
 
 
@@ -158,11 +218,10 @@ int main()
         switch (menuState) {
             // Displays the main menu screen
             case 0:
-                // Clears display and unblocks the time api thread when changing screens to ensure that the data is up to date
+                // Clears display when changing screens
                 if (menuSwitched == true) {
                     lcd.clear();
                     menuSwitched = false;
-                    sharedData.timeThreadFlag.set(timeFlagBtn); 
                 }
 
                 // Depending on user action this will either display main menu or show alarm menu
@@ -170,8 +229,8 @@ int main()
                     // Shows the alarmMenu used to set an alarm
                     alarmMenu(&alarmData, &lcd, &pot);
                 }  else {
-                    // Uses the timeApiCheck function to regularly update the time data and the mainMenu function to displays the main menu screen
-                    timeApiCheck(&sharedData, &lcd);
+                    // Uses the refreshCheck function to keep the clock synced and the mainMenu function to displays the main menu screen
+                    refreshCheck(&sharedData, FetchClock, &lcd);
                     mainMenu(&alarmData, &systemTimeData, &lcd);
                 }
                 
@@ -185,7 +244,8 @@ int main()
                     menuSwitched = false;
                 }
                 
-                // Runs the sensor menu function to get and display sensor data
+                // Lets the scheduler refresh data in the background and runs the sensor menu function to get and display sensor data
+                refreshCheck(&sharedData, FetchJobCount, &lcd);
                 sensorMenu(&lcd, &hts221);
                 
                 break;
@@ -193,48 +253,56 @@ int main()
             // Displays the weather menu screen
             case 2: 
                 
-                // Clears display and unblocks the weather api thread when changing screens to ensure that the data is up to date
+                // Clears display when changing screens. The weather is fetched if it is older than its budget for a shown screen
                 if (menuSwitched == true) {
                     lcd.clear();
                     menuSwitched = false;
-                    sharedData.weatherThreadFlag.set(weatherFlagBtn); 
                 }
 
                 // Checks if the user wants to go to the change locations menu
                 if (changeLocationData.changeLocation == true) {
                     lcd.clear();
-                    changeLocationMenu(&sharedData, &lcd, &pot, &weatherThread, &changeLocationData);
+                    changeLocationMenu(&sharedData, &lcd, &pot, &changeLocationData);
                 }
 
-                // Uses the weatherApiCheck function to regularly update the time data and the weatherMenu function to displays the weather menu screen
+                // Uses the refreshCheck function to regularly update the weather data and the weatherMenu function to displays the weather menu screen
                 weatherMenu(&sharedData, &lcd);
-                weatherApiCheck(&sharedData, &lcd);
+                refreshCheck(&sharedData, FetchWeather, &lcd);
                 
                 break;
 
             // Displays the RSS menu screen
             case 3: 
-                // Clears display and unblocks the rss thread when changing screens to ensure that the data is up to date
+                // Clears display when changing screens
                 if (menuSwitched == true) {
                     lcd.clear();
-                    sharedData.rssThreadFlag.set(rssFlagBtn); 
                     menuSwitched = false;
                 } 
 
-                // Gets the rss feed string from the rssMenu function. This function also prints the title of the rss feed
-                rssFeed = rssMenu(&sharedData, &lcd, &menuSwitched);
-                // Uses the scrollFeed function to scroll the rss feed on line 2 
-                scrollFeed(&menuSwitched, rssFeed, &alarmData, &systemTimeData, &buzzer, &lcd);
+                // Fetches the RSS feed if it is older than its budget for a shown screen
+                refreshCheck(&sharedData, FetchRss, &lcd);
+
+                // Prints the title of the rss feed and runs the feed through line 2 as a ticker. The ticker keeps going as long as the feed is the same
+                rssMenu(&sharedData, &lcd);
 
-                if (menuSwitched == false) {
-                    // Unblocks the rss thread to recive the updated rss feed when it has finished scrolling passed once. We use an if statment to avoid fetching the RSS feed again when the user exits the RSS menu by changing screens
-                    sharedData.rssThreadFlag.set(rssFlagBtn); 
+                break;
+
+            // Displays the diagnostics screen with the request timing and circuit breaker of each endpoint
+            case 4:
+                // Clears display when changing screens, and prints the full timing breakdown on the serial console
+                if (menuSwitched == true) {
+                    lcd.clear();
+                    menuSwitched = false;
+                    sharedData.stats.print();
                 }
 
+                refreshCheck(&sharedData, FetchJobCount, &lcd);
+                diagnosticsMenu(&sharedData, &lcd);
+
                 break;
 
             // Completes the menu loop by setting the menu back to default screen
-            case 4:
+            case 5:
                 
                 menuState = 0;
                 break;
@@ -250,6 +318,9 @@ int main()
         // This funciton is also called from inside loops other places in the code where the loop stops this function from beeing run for a longer period of time
         alarmCheck(&alarmData, &systemTimeData, &buzzer);
 
+        // Hands the frame to the display thread without waiting for the bus. The screens draw every pass, so the sleep sets the pace of the loop
+        lcd.submit();
+        thread_sleep_for(MBED_CONF_APP_FRAME_TIME);
     }
 }
 
@@ -0,0 +1,122 @@
+/**
+ * @file   networkManager.cpp
+ * @author Tobias Kallevik
+*/
+
+#include "networkManager.h"
+#include <cstdio>
+
+NetworkManager::NetworkManager() : _network(nullptr), _up(false), _drops(0), _failures(0) {
+}
+
+void NetworkManager::init(NetworkInterface *network) {
+    _network = network;
+    _network->attach(callback(this, &NetworkManager::statusChanged));
+}
+
+// Called from the driver, so it only records the state
+void NetworkManager::statusChanged(nsapi_event_t event, intptr_t value) {
+    if (event != NSAPI_EVENT_CONNECTION_STATUS_CHANGE) {
+        return;
+    }
+
+    setUp(value == NSAPI_STATUS_LOCAL_UP || value == NSAPI_STATUS_GLOBAL_UP);
+}
+
+void NetworkManager::setUp(bool up) {
+    bool wasUp = core_util_atomic_load_bool(&_up);
+    core_util_atomic_store_bool(&_up, up);
+
+    if (wasUp && !up) {
+        core_util_atomic_incr_u32(&_drops, 1);
+    }
+}
+
+void NetworkManager::connect() {
+    nsapi_error_t result;
+
+    // Waits longer after each failure so a missing access point isn't retried in a tight loop
+    Backoff backoff(NETWORK_RETRY_BASE_MS, NETWORK_RETRY_MAX_MS);
+    do {
+        printf("\nConnecting to the network");
+        result = _network->connect();
+
+        // The module may still be associated after a drop was assumed from failed fetches
+        if (result == NSAPI_ERROR_IS_CONNECTED) {
+            result = NSAPI_ERROR_OK;
+        }
+
+        if (result != NSAPI_ERROR_OK) {
+            uint32_t wait = backoff.next();
+            printf("\nFailed to connect to network: %d, retrying in %u ms", result, wait);
+            thread_sleep_for(wait);
+        }
+    } while (result != NSAPI_ERROR_OK);
+
+    _failures = 0;
+    setUp(true);
+    printf("\nConnected to network!");
+}
+
+bool NetworkManager::waitUntilUp() {
+    if (up()) {
+        return false;
+    }
+
+    Kernel::Clock::time_point downAt = Kernel::Clock::now();
+    printf("\nNetwork link down, rejoining");
+
+    // The module still says it's associated when the drop was assumed from failed fetches, so it's made to associate again
+    if (_network->get_connection_status() != NSAPI_STATUS_DISCONNECTED) {
+        _network->disconnect();
+    }
+
+    connect();
+    printf("\nRejoined in %d ms", (int)duration_cast<milliseconds>(Kernel::Clock::now() - downAt).count());
+    return true;
+}
+
+// The status callback is trusted when the module reports a drop. The module's own status is checked
+// too, since not every driver sends the callback. Without an interface there is nothing to rejoin
+bool NetworkManager::up() const {
+    if (_network == nullptr) {
+        return true;
+    }
+
+    return core_util_atomic_load_bool(&_up) && _network->get_connection_status() != NSAPI_STATUS_DISCONNECTED;
+}
+
+void NetworkManager::fetchDone(nsapi_error_t result) {
+    if (!linkError(result)) {
+        _failures = 0;
+        return;
+    }
+
+    if (_network != nullptr && ++_failures >= MBED_CONF_APP_LINK_FAILURE_THRESHOLD) {
+        printf("\n%d fetches failed in a row, assuming the link is down", _failures);
+        setUp(false);
+        _failures = 0;
+    }
+}
+
+// A TLS or HTTP error means the server was reached, and a refused connection ends in a connect timeout or a lost connection
+bool NetworkManager::linkError(nsapi_error_t result) {
+    switch (result) {
+        case NSAPI_ERROR_NO_CONNECTION:
+        case NSAPI_ERROR_NO_SOCKET:
+        case NSAPI_ERROR_NO_ADDRESS:
+        case NSAPI_ERROR_DNS_FAILURE:
+        case NSAPI_ERROR_CONNECTION_LOST:
+        case NSAPI_ERROR_CONNECTION_TIMEOUT:
+        case NSAPI_ERROR_WOULD_BLOCK:
+        case NSAPI_ERROR_TIMEOUT:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+uint32_t NetworkManager::drops() const {
+    return core_util_atomic_load_u32(&_drops);
+}
@@ -0,0 +1,109 @@
+/**
+ * @file   persistentStore.cpp
+ * @author Tobias Kallevik
+*/
+
+#include "persistentStore.h"
+#include <cstdio>
+#include <cstring>
+
+// Header and record, padded to whole flash pages. Rounding up to a page adds less than a page. Static since
+// it's too big for the network thread stack
+static uint8_t sectorBuffer[sizeof(PersistHeader) + PERSIST_MAX_SIZE + PERSIST_MAX_PAGE_SIZE - 1];
+
+PersistentStore::PersistentStore()
+    : _open(false), _address(0), _sectorSize(0), _pageSize(0), _haveSaved(false), _savedCrc(0) {
+}
+
+// Finds the last sector of the flash. The application is linked from the start of the flash and is far
+// smaller than the 1 MB on this board, so the last sector is free
+bool PersistentStore::open() {
+    if (_open) {
+        return true;
+    }
+
+    if (_flash.init() != 0) {
+        printf("\nFailed to open the flash");
+        return false;
+    }
+
+    uint32_t end = _flash.get_flash_start() + _flash.get_flash_size();
+    _sectorSize = _flash.get_sector_size(end - 1);
+    _pageSize = _flash.get_page_size();
+    _address = end - _sectorSize;
+
+    // A bigger page would make a padded record overrun the buffer
+    if (_pageSize > PERSIST_MAX_PAGE_SIZE) {
+        printf("\nFlash page of %u bytes is too big", (unsigned int)_pageSize);
+        _flash.deinit();
+        return false;
+    }
+    _open = true;
+    return true;
+}
+
+bool PersistentStore::load(void *data, uint16_t size, uint16_t version) {
+    if (size > PERSIST_MAX_SIZE || !open()) {
+        return false;
+    }
+
+    PersistHeader header;
+    if (_flash.read(&header, _address, sizeof(header)) != 0) {
+        return false;
+    }
+    if (header.magic != PERSIST_MAGIC || header.version != version || header.length != size) {
+        return false;
+    }
+
+    if (_flash.read(data, _address + sizeof(header), size) != 0 || crc32(data, size) != header.crc) {
+        printf("\nStored data is damaged");
+        return false;
+    }
+
+    _haveSaved = true;
+    _savedCrc = header.crc;
+    _savedAt = Kernel::Clock::now();
+    return true;
+}
+
+bool PersistentStore::save(const void *data, uint16_t size, uint16_t version) {
+    if (size > PERSIST_MAX_SIZE) {
+        return false;
+    }
+
+    // Skips records that are unchanged, and limits how often the sector is erased
+    uint32_t crc = crc32(data, size);
+    Kernel::Clock::time_point now = Kernel::Clock::now();
+    if (_haveSaved && (crc == _savedCrc || now - _savedAt < seconds(MBED_CONF_APP_PERSIST_MIN_INTERVAL))) {
+        return false;
+    }
+
+    if (!open()) {
+        return false;
+    }
+
+    PersistHeader header;
+    header.magic = PERSIST_MAGIC;
+    header.version = version;
+    header.length = size;
+    header.crc = crc;
+    header.reserved = 0;
+
+    // Flash is programmed in whole pages, so the rest of the last page is filled with the erased value
+    uint32_t length = sizeof(header) + size;
+    length = (length + _pageSize - 1) / _pageSize * _pageSize;
+    memset(sectorBuffer, _flash.get_erase_value(), sizeof(sectorBuffer));
+    memcpy(sectorBuffer, &header, sizeof(header));
+    memcpy(sectorBuffer + sizeof(header), data, size);
+
+    // A power loss between the erase and the program leaves no valid record, which load() detects
+    if (_flash.erase(_address, _sectorSize) != 0 || _flash.program(sectorBuffer, _address, length) != 0) {
+        printf("\nFailed to write to the flash");
+        return false;
+    }
+
+    _haveSaved = true;
+    _savedCrc = crc;
+    _savedAt = now;
+    return true;
+}
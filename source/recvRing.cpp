@@ -0,0 +1,46 @@
+/**
+ * @file   recvRing.cpp
+ * @author Tobias Kallevik
+*/
+
+#include "recvRing.h"
+
+static_assert((RECV_RING_SIZE & (RECV_RING_SIZE - 1)) == 0, "RECV_RING_SIZE must be a power of two");
+
+ByteSpan RecvRing::space() {
+    uint32_t start = _write % RECV_RING_SIZE;
+    size_t length = RECV_RING_SIZE - size();
+
+    // The free space may wrap around the end too, and only the part up to the end is contiguous
+    if (start + length > RECV_RING_SIZE) {
+        length = RECV_RING_SIZE - start;
+    }
+
+    ByteSpan span = {_buffer + start, length};
+    return span;
+}
+
+void RecvRing::commit(size_t length) {
+    _write += length;
+}
+
+ByteSpan RecvRing::front() {
+    uint32_t start = _read % RECV_RING_SIZE;
+    size_t length = size();
+
+    if (start + length > RECV_RING_SIZE) {
+        length = RECV_RING_SIZE - start;
+    }
+
+    ByteSpan span = {_buffer + start, length};
+    return span;
+}
+
+// Starts from the beginning of the buffer when it empties, so the next receive gets the whole ring in one span
+void RecvRing::consume(size_t length) {
+    _read += length;
+
+    if (_read == _write) {
+        clear();
+    }
+}
@@ -0,0 +1,116 @@
+/**
+ * @file   refreshScheduler.cpp
+ * @author Tobias Kallevik
+*/
+
+#include "refreshScheduler.h"
+
+void RefreshScheduler::configure(FetchJob job, int freshness, int visibleFreshness, int minInterval) {
+    _mutex.lock();
+    _sources[job].enabled = true;
+    _sources[job].freshness = freshness;
+    _sources[job].visibleFreshness = visibleFreshness;
+    _sources[job].minInterval = minInterval;
+    _mutex.unlock();
+}
+
+void RefreshScheduler::setFreshness(FetchJob job, int freshness, int visibleFreshness) {
+    _mutex.lock();
+    _sources[job].freshness = freshness;
+    _sources[job].visibleFreshness = visibleFreshness;
+    _mutex.unlock();
+}
+
+void RefreshScheduler::setVisible(FetchJob job) {
+    _mutex.lock();
+    _visible = job;
+    _mutex.unlock();
+}
+
+void RefreshScheduler::fetched(FetchJob job, bool succeeded) {
+    Kernel::Clock::time_point now = Kernel::Clock::now();
+
+    _mutex.lock();
+    _sources[job].lastAttempt = now;
+    _sources[job].inFlight = false;
+    if (succeeded) {
+        _sources[job].lastSuccess = now;
+        _sources[job].fetched = true;
+    }
+    _mutex.unlock();
+}
+
+void RefreshScheduler::skipped(FetchJob job) {
+    _mutex.lock();
+    _sources[job].inFlight = false;
+    _mutex.unlock();
+}
+
+// A source is due when its data is older than its budget. Sources that have used most of their budget are
+// fetched in the same burst. A source that failed waits for its min interval and its backoff before the next try
+bool RefreshScheduler::poll(FetchQueue *queue, const CircuitBreaker *health) {
+    Kernel::Clock::time_point now = Kernel::Clock::now();
+    bool wanted[FetchJobCount];
+    bool anyDue = false;
+
+    _mutex.lock();
+
+    for (int i = 0; i < FetchJobCount; i++) {
+        RefreshSource &source = _sources[i];
+        wanted[i] = false;
+
+        if (!source.enabled || source.inFlight || health[i].retryIn() > 0) {
+            continue;
+        }
+        if (source.lastAttempt != Kernel::Clock::time_point() && now - source.lastAttempt < seconds(source.minInterval)) {
+            continue;
+        }
+
+        // Data never fetched is always due
+        if (!source.fetched) {
+            wanted[i] = true;
+            anyDue = true;
+            continue;
+        }
+
+        seconds age = duration_cast<seconds>(now - source.lastSuccess);
+        int limit = budget(static_cast<FetchJob>(i));
+        if (age.count() >= limit) {
+            wanted[i] = true;
+            anyDue = true;
+        } else if (age.count() >= limit * REFRESH_BATCH_FRACTION) {
+            wanted[i] = true;
+        }
+    }
+
+    FetchJob visible = _visible;
+
+    // Marked before they are queued, so a fetch that finishes right away still clears the mark
+    if (anyDue) {
+        for (int i = 0; i < FetchJobCount; i++) {
+            _sources[i].inFlight |= wanted[i];
+        }
+    }
+    _mutex.unlock();
+
+    if (!anyDue) {
+        return false;
+    }
+
+    // The visible source goes first
+    bool visibleQueued = false;
+    for (int i = 0; i < FetchJobCount; i++) {
+        if (wanted[i]) {
+            FetchPriority priority = i == visible ? PriorityUser : PriorityBackground;
+            bool added = queue->request(static_cast<FetchJob>(i), priority);
+            visibleQueued |= added && i == visible;
+        }
+    }
+
+    return visibleQueued;
+}
+
+// Called with the mutex locked
+int RefreshScheduler::budget(FetchJob job) const {
+    return job == _visible ? _sources[job].visibleFreshness : _sources[job].freshness;
+}
@@ -0,0 +1,289 @@
+/**
+ * @file   rssParser.cpp
+ * @author Tobias Kallevik
+*/
+
+#include "rssParser.h"
+#include <cstring>
+#include <cstdlib>
+
+// Start of a CDATA section after "<!"
+static const char cdataStart[] = "[CDATA[";
+
+// Start of a comment after "<!"
+static const char commentStart[] = "--";
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+RssParser::RssParser(int maxItems, RssTitleHandler handler, void *context)
+    : _maxItems(maxItems), _handler(handler), _context(context) {
+    reset();
+}
+
+void RssParser::reset() {
+    _state = Text;
+    _items = 0;
+    _inItem = false;
+    _inTitle = false;
+    _haveFeedTitle = false;
+    _tagLength = 0;
+    _closingTag = false;
+    _selfClosing = false;
+    _quote = 0;
+    _markupMatched = 0;
+    _endMatched = 0;
+    _entityLength = 0;
+    _titleLength = 0;
+}
+
+bool RssParser::feed(const char *data, size_t length) {
+    for (size_t i = 0; i < length && !complete(); i++) {
+        step(data[i]);
+    }
+    return !complete();
+}
+
+// Runs one char through the tokenizer
+void RssParser::step(char c) {
+    switch (_state) {
+        // Text between tags. Only text inside a wanted title is kept
+        case Text:
+            if (c == '<') {
+                _state = TagStart;
+            } else if (_inTitle && c == '&') {
+                _entityLength = 0;
+                _state = Entity;
+            } else {
+                titleChar(c);
+            }
+            break;
+
+        // The char after '<' tells what kind of tag it is
+        case TagStart:
+            _tagLength = 0;
+            _selfClosing = false;
+            _closingTag = false;
+            if (c == '/') {
+                _closingTag = true;
+                _state = TagName;
+            } else if (c == '!') {
+                _markupMatched = 0;
+                _state = Markup;
+            } else if (c == '?') {
+                _state = Skip;
+            } else {
+                _state = TagName;
+                step(c);
+            }
+            break;
+
+        case TagName:
+            if (isSpace(c) || c == '/' || c == '>') {
+                endTagName();
+                _state = TagAttributes;
+                step(c);
+            } else if (_tagLength < RSS_TAG_SIZE - 1) {
+                _tag[_tagLength++] = c;
+            } else {
+                // Too long to be one of the wanted tags
+                _tagLength = RSS_TAG_SIZE;
+            }
+            break;
+
+        // Skips attributes until the end of the tag. Quoted values may contain '>'
+        case TagAttributes:
+            if (c == '"' || c == '\'') {
+                _quote = c;
+                _selfClosing = false;
+                _state = TagQuote;
+            } else if (c == '/') {
+                _selfClosing = true;
+            } else if (c == '>') {
+                _state = Text;
+                if (_closingTag) {
+                    endElement();
+                } else {
+                    startElement();
+                    if (_selfClosing) {
+                        endElement();
+                    }
+                }
+            } else if (!isSpace(c)) {
+                _selfClosing = false;
+            }
+            break;
+
+        case TagQuote:
+            if (c == _quote) {
+                _state = TagAttributes;
+            }
+            break;
+
+        // After "<!", a CDATA section, a comment or a declaration like DOCTYPE
+        case Markup:
+            if (_markupMatched < 7 && c == cdataStart[_markupMatched]) {
+                if (++_markupMatched == 7) {
+                    _endMatched = 0;
+                    _state = CData;
+                }
+            } else if (_markupMatched < 2 && c == commentStart[_markupMatched]) {
+                if (++_markupMatched == 2) {
+                    _endMatched = 0;
+                    _state = Comment;
+                }
+            } else {
+                _state = c == '>' ? Text : Skip;
+            }
+            break;
+
+        // CDATA text is kept as it is until "]]>"
+        case CData:
+            if (c == ']' && _endMatched < 2) {
+                _endMatched++;
+            } else if (c == ']') {
+                titleChar(']');
+            } else if (c == '>' && _endMatched == 2) {
+                _state = Text;
+            } else {
+                for (int i = 0; i < _endMatched; i++) {
+                    titleChar(']');
+                }
+                _endMatched = 0;
+                titleChar(c);
+            }
+            break;
+
+        case Comment:
+            if (c == '-') {
+                if (_endMatched < 2) {
+                    _endMatched++;
+                }
+            } else if (c == '>' && _endMatched == 2) {
+                _state = Text;
+            } else {
+                _endMatched = 0;
+            }
+            break;
+
+        case Skip:
+            if (c == '>') {
+                _state = Text;
+            }
+            break;
+
+        // Reads an entity like &amp; or &#8217;. Anything too long to be one is kept as text
+        case Entity:
+            if (c == ';') {
+                endEntity();
+                _state = Text;
+            } else if (_entityLength < RSS_ENTITY_SIZE - 1 && c != '<' && c != '&' && !isSpace(c)) {
+                _entity[_entityLength++] = c;
+            } else {
+                titleChar('&');
+                for (size_t i = 0; i < _entityLength; i++) {
+                    titleChar(_entity[i]);
+                }
+                _state = Text;
+                step(c);
+            }
+            break;
+    }
+}
+
+void RssParser::endTagName() {
+    if (_tagLength < RSS_TAG_SIZE) {
+        _tag[_tagLength] = 0;
+    } else {
+        _tag[0] = 0;
+    }
+}
+
+// The feed title is the first title outside an item. Later titles outside items (like the image title) are ignored
+void RssParser::startElement() {
+    if (strcmp(_tag, "item") == 0) {
+        _inItem = true;
+        _inTitle = false;
+        _titleLength = 0;
+    } else if (strcmp(_tag, "title") == 0 && (_inItem || !_haveFeedTitle)) {
+        _inTitle = true;
+        _titleLength = 0;
+    }
+}
+
+// Emits the feed title when it ends, and the item title when the item ends
+void RssParser::endElement() {
+    if (strcmp(_tag, "title") == 0 && _inTitle) {
+        _inTitle = false;
+        if (!_inItem) {
+            _haveFeedTitle = true;
+            emitTitle(0);
+        }
+    } else if (strcmp(_tag, "item") == 0 && _inItem) {
+        _inItem = false;
+        _inTitle = false;
+        _items++;
+        emitTitle(_items);
+    }
+}
+
+// Adds a char to the title. Line breaks and runs of spaces become a single space since the title is shown on one line
+void RssParser::titleChar(char c) {
+    if (!_inTitle) {
+        return;
+    }
+
+    if (isSpace(c)) {
+        if (_titleLength == 0 || _title[_titleLength - 1] == ' ') {
+            return;
+        }
+        c = ' ';
+    }
+
+    if (_titleLength < RSS_TITLE_SIZE - 1) {
+        _title[_titleLength++] = c;
+    }
+}
+
+// Replaces an entity with the char it stands for. The display only has ASCII, so common typographic
+// chars are replaced with the closest ASCII char and anything else with '?'
+void RssParser::endEntity() {
+    _entity[_entityLength] = 0;
+    long code = -1;
+
+    if (strcmp(_entity, "amp") == 0) code = '&';
+    else if (strcmp(_entity, "lt") == 0) code = '<';
+    else if (strcmp(_entity, "gt") == 0) code = '>';
+    else if (strcmp(_entity, "quot") == 0) code = '"';
+    else if (strcmp(_entity, "apos") == 0) code = '\'';
+    else if (_entity[0] == '#' && (_entity[1] == 'x' || _entity[1] == 'X')) code = strtol(_entity + 2, nullptr, 16);
+    else if (_entity[0] == '#') code = strtol(_entity + 1, nullptr, 10);
+
+    if (code == 160) {
+        code = ' ';
+    } else if (code == 8216 || code == 8217) {
+        code = '\'';
+    } else if (code == 8220 || code == 8221) {
+        code = '"';
+    } else if (code == 8211 || code == 8212) {
+        code = '-';
+    } else if (code < 0 || code >= 0x80) {
+        code = '?';
+    }
+
+    titleChar((char)code);
+}
+
+void RssParser::emitTitle(int item) {
+    // Removes a trailing space left by the whitespace folding
+    if (_titleLength > 0 && _title[_titleLength - 1] == ' ') {
+        _titleLength--;
+    }
+    _title[_titleLength] = 0;
+
+    if (_handler != nullptr) {
+        _handler(_context, item, _title);
+    }
+    _titleLength = 0;
+}
@@ -9,8 +9,13 @@
 #include <cstdio>
 
 // Boot up menu
-void bootUp(SharedData *sharedData, DFRobot_RGBLCD *lcd) {
-    // Shows bootup screens at startup. Mutex isn't needed since we know this is the only thread to access these variables during this time
+void bootUp(SharedData *sharedData, LcdCanvas *lcd) {
+    // Shows bootup screens at startup
+    TimeSnapshot timeSnapshot;
+    sharedData->timeSnapshot.read(&timeSnapshot);
+    sharedData->mutex.lock();
+    string city = sharedData->city;
+    sharedData->mutex.unlock();
 
     // Shows epoch time
     int i = 0;
@@ -19,9 +24,10 @@ void bootUp(SharedData *sharedData, DFRobot_RGBLCD *lcd) {
         lcd->setCursor(0, 0);
         lcd->printf("Unix epoch time:");
         lcd->setCursor(0, 1);
-        lcd->printf("%i", (time(NULL) - (sharedData->timezoneOffsetWithDst * 3600)));
+        lcd->printf("%i", (time(NULL) - (timeSnapshot.timezoneOffsetWithDst * 3600)));
+        lcd->submit();
         i++;
-        thread_sleep_for(1000);
+        thread_sleep_for(MBED_CONF_APP_BOOT_SCREEN_TIME / 2);
     }
 
     lcd->clear();
@@ -29,10 +35,11 @@ void bootUp(SharedData *sharedData, DFRobot_RGBLCD *lcd) {
     // Shows coordinates
     lcd->printf("                ");
     lcd->setCursor(0, 0);
-    lcd->printf("Lat: %s", sharedData->latitude.c_str());
+    lcd->printf("Lat: %s", timeSnapshot.latitude);
     lcd->setCursor(0, 1);
-    lcd->printf("Lon: %s", sharedData->longitude.c_str());
-    thread_sleep_for(2000);
+    lcd->printf("Lon: %s", timeSnapshot.longitude);
+    lcd->submit();
+    thread_sleep_for(MBED_CONF_APP_BOOT_SCREEN_TIME);
     lcd->clear();
 
     // Shows city gotten from IP
@@ -40,12 +47,13 @@ void bootUp(SharedData *sharedData, DFRobot_RGBLCD *lcd) {
     lcd->setCursor(0, 0);
     lcd->printf("City:");
     lcd->setCursor(0, 1);
-    lcd->printf("%s", sharedData->city.c_str());
-    thread_sleep_for(2000);
+    lcd->printf("%s", city.c_str());
+    lcd->submit();
+    thread_sleep_for(MBED_CONF_APP_BOOT_SCREEN_TIME);
 }
 
 // Main clock menu
-void mainMenu(AlarmData *alarmData, SystemTimeData *systemTimeData, DFRobot_RGBLCD *lcd) {
+void mainMenu(AlarmData *alarmData, SystemTimeData *systemTimeData, LcdCanvas *lcd) {
 
     char timeBuffer[64];
     char alarmTimeBuffer[64];
@@ -100,7 +108,7 @@ void mainMenu(AlarmData *alarmData, SystemTimeData *systemTimeData, DFRobot_RGBL
 }
 
 // Menu for setting alarm
-void alarmMenu(AlarmData *alarmData, DFRobot_RGBLCD *lcd, AnalogIn *pot){
+void alarmMenu(AlarmData *alarmData, LcdCanvas *lcd, AnalogIn *pot){
 
     // Reads the potensiometer to change the minute or hour of an alarm
     if (alarmData->switchAlarmInputs == false) {
@@ -117,7 +125,7 @@ void alarmMenu(AlarmData *alarmData, DFRobot_RGBLCD *lcd, AnalogIn *pot){
 }
 
 // menu for mesuring and showing sensor data
-void sensorMenu(DFRobot_RGBLCD *lcd, HTS221Sensor *hts221) {
+void sensorMenu(LcdCanvas *lcd, HTS221Sensor *hts221) {
     // Float values for sansor data
     float temp = 0;
     float humidity = 0;
@@ -135,23 +143,21 @@ void sensorMenu(DFRobot_RGBLCD *lcd, HTS221Sensor *hts221) {
 }
 
 // Menu for showing the weather forcast
-void weatherMenu(SharedData *sharedData, DFRobot_RGBLCD *lcd) {
-    // Uses a mutex to safely retrive weather data
-    sharedData->mutex.lock();
-    string weatherCondition = sharedData->weatherCondition;
-    int outdoorTemp = sharedData->outdoorTemp;
-    sharedData->mutex.unlock();
+void weatherMenu(SharedData *sharedData, LcdCanvas *lcd) {
+    // Reads the latest weather data. This never waits for a fetch in progress
+    WeatherSnapshot weather;
+    sharedData->weatherSnapshot.read(&weather);
 
     // Prints the weather data to display 
     lcd->printf("                ");
     lcd->setCursor(0, 0);
-    lcd->printf("%s", weatherCondition.c_str());
+    lcd->printf("%s", weather.weatherCondition);
     lcd->setCursor(0, 1);
-    lcd->printf("%i degrees", outdoorTemp);
+    lcd->printf("%i degrees", weather.outdoorTemp);
 }
 
 // Menu for changing the location used to retrive weather data
-void changeLocationMenu(SharedData *sharedData, DFRobot_RGBLCD *lcd, AnalogIn *pot, Thread *weatherThread, ChangeLocationData *changeLocationData) {
+void changeLocationMenu(SharedData *sharedData, LcdCanvas *lcd, AnalogIn *pot, ChangeLocationData *changeLocationData) {
 
     // Get the old city
     sharedData->mutex.lock();
@@ -226,11 +232,8 @@ void changeLocationMenu(SharedData *sharedData, DFRobot_RGBLCD *lcd, AnalogIn *p
             sharedData->city = newCity;
             sharedData->mutex.unlock();
 
-            // Ensures that the threads run in proper order
-            sharedData->mainThreadFlag.clear(mainFlagBtn);
-            sharedData->weatherThreadFlag.set(weatherFlagBtn);
-            sharedData->mainThreadFlag.wait_all(mainFlagBtn);
-            sharedData->mainThreadFlag.clear(mainFlagBtn);
+            // Fetches the weather for the new city and waits for the answer
+            sharedData->fetchQueue.requestAndWait(FetchWeather, PriorityUser);
 
             // Uses a mutex to safely revert the change if the city isnt valid
             sharedData->mutex.lock();
@@ -238,6 +241,7 @@ void changeLocationMenu(SharedData *sharedData, DFRobot_RGBLCD *lcd, AnalogIn *p
             if (sharedData->city == "error") {
                 lcd->clear();
                 lcd->printf("Non valid city");
+                lcd->submit();
                 sharedData->city = oldCity;
                 thread_sleep_for(1000);
             } 
@@ -246,31 +250,75 @@ void changeLocationMenu(SharedData *sharedData, DFRobot_RGBLCD *lcd, AnalogIn *p
             lcd->clear();    
             return;
         }  
+
+        // Shows the letters picked so far
+        lcd->submit();
+        thread_sleep_for(MBED_CONF_APP_FRAME_TIME);
     }
 
     lcd->clear();  
 }
 
 // Menu used to show the 3 lates top news stories from the rss feed
-string rssMenu(SharedData *sharedData, DFRobot_RGBLCD *lcd, bool *menuSwitched) {
+void rssMenu(SharedData *sharedData, LcdCanvas *lcd) {
+
+    // Reads the latest RSS titles. This never waits for a fetch in progress. Static since the titles and the feed are too big for the stack
+    static RssSnapshot rss;
+    static char fullRssFeed[MBED_CONF_APP_TICKER_SIZE];
+    sharedData->rssSnapshot.read(&rss);
+
+    // Joins all the RSS headline titles and adds spaces between them for better viewing when shown on LCD
+    const char *gap = "                ";
+    size_t length = snprintf(fullRssFeed, sizeof(fullRssFeed), "%s", gap);
+    for (int i = 0; i < RSS_NEWS_ITEMS && length < sizeof(fullRssFeed); i++) {
+        length += snprintf(fullRssFeed + length, sizeof(fullRssFeed) - length, "%s%s", rss.newsTitles[i], gap);
+    }
+    
+    // Prints the title for the RSS news feed, and scrolls the feed on line 2. The display thread moves the ticker, so this returns right away
+    lcd->setCursor(0, 0);
+    lcd->printf("%s", rss.rssFeedTitle);
+    lcd->ticker(1, fullRssFeed);
+}
 
-    // Locks the mutex for safe retrival of the RSS feed strings
-    sharedData->mutex.lock();
-    string rssFeedTitle = sharedData->rssFeedTitle;
-    string newsTitle1 = sharedData->newsTitle1;
-    string newsTitle2 = sharedData->newsTitle2;
-    string newsTitle3 = sharedData->newsTitle3;
-    sharedData->mutex.unlock();
+// Names of the circuit breaker states, as shown on the diagnostics screen
+static const char *const circuitStateNames[] = {"closed", "open", "half open"};
+
+// Shows two pages for each endpoint in turn. The first has the request count, failures and p50/p95 total
+// time, and the second the state of its circuit breaker, its failures in a row and the seconds until it may
+// be fetched again
+void diagnosticsMenu(SharedData *sharedData, LcdCanvas *lcd) {
+    char line[17];
+    int page = (time(NULL) / DIAGNOSTICS_PAGE_TIME) % (FetchJobCount * 2);
+    FetchJob job = static_cast<FetchJob>(page / 2);
+    FetchSummary summary;
 
-    // Creates a new string containg all the RSS headling titles and adds spaces between them for better viewing when shown on LCD
-    string fullRssFeed = "                " + newsTitle1 + 
-                         "                " + newsTitle2 + 
-                         "                " + newsTitle3 + 
-                         "                ";
-    
-    // Prints the title for the RSS news feed
     lcd->setCursor(0, 0);
-    lcd->printf("%s", rssFeedTitle.c_str());
+    if (page % 2 == 1) {
+        CircuitBreaker *health = &sharedData->fetchHealth[job];
+        int retryIn = health->retryIn();
+
+        snprintf(line, sizeof(line), "%-8s circuit", fetchJobNames[job]);
+        lcd->printf("%-16s", line);
+        lcd->setCursor(0, 1);
+        int length = snprintf(line, sizeof(line), "%s f%d", circuitStateNames[health->state()], health->failures());
+        if (retryIn > 0 && length < (int)sizeof(line)) {
+            snprintf(line + length, sizeof(line) - length, " %ds", retryIn);
+        }
+        lcd->printf("%-16s", line);
+        return;
+    }
 
-    return fullRssFeed;
-}
\ No newline at end of file
+    if (!sharedData->stats.summary(job, &summary)) {
+        snprintf(line, sizeof(line), "%-16s", fetchJobNames[job]);
+        lcd->printf("%s", line);
+        lcd->setCursor(0, 1);
+        lcd->printf("No requests     ");
+        return;
+    }
+
+    snprintf(line, sizeof(line), "%-8s n%-2d f%-2d", fetchJobNames[job], summary.count, summary.failures);
+    lcd->printf("%-16s", line);
+    lcd->setCursor(0, 1);
+    snprintf(line, sizeof(line), "%d/%dms", (int)summary.p50[TimingTotal], (int)summary.p95[TimingTotal]);
+    lcd->printf("%-16s", line);
+}
@@ -0,0 +1,83 @@
+/**
+ * @file   sntpClient.cpp
+ * @author Tobias Kallevik
+*/
+
+#include "sntpClient.h"
+#include <cstdio>
+#include <cstdlib>
+
+void SntpClient::setNetwork(NetworkInterface *network, DnsCache *dns) {
+    _network = network;
+    _dns = dns;
+}
+
+nsapi_error_t SntpClient::query(SntpTime *time, Kernel::Clock::time_point *receivedAt, RequestTiming *timing) {
+    if (_network == nullptr) {
+        return NSAPI_ERROR_NO_CONNECTION;
+    }
+
+    RequestTiming unusedTiming;
+    if (timing == nullptr) {
+        timing = &unusedTiming;
+    }
+    *timing = RequestTiming();
+    Kernel::Clock::time_point start = Kernel::Clock::now();
+
+    SocketAddress address;
+    nsapi_error_t result = _dns->resolve(MBED_CONF_APP_SNTP_SERVER, &address);
+    timing->ms[TimingDns] = duration_cast<milliseconds>(Kernel::Clock::now() - start).count();
+    if (result == NSAPI_ERROR_OK) {
+        address.set_port(MBED_CONF_APP_SNTP_PORT);
+        result = exchange(address, time, receivedAt, timing);
+    }
+
+    timing->ms[TimingTotal] = duration_cast<milliseconds>(Kernel::Clock::now() - start).count();
+    timing->result = result;
+    return result;
+}
+
+// Sends one request and waits for its answer. The round trip is the time to first byte, since the answer is a single packet
+nsapi_error_t SntpClient::exchange(const SocketAddress &address, SntpTime *time, Kernel::Clock::time_point *receivedAt, RequestTiming *timing) {
+    UDPSocket socket;
+    socket.open(_network);
+    socket.set_timeout(MBED_CONF_APP_SNTP_TIMEOUT);
+
+    // The transmit timestamp only has to be unique, so a counter and a random part are used instead of the clock
+    uint64_t transmitTimestamp = ((uint64_t)++_requests << 32) | (uint32_t)rand();
+    uint8_t packet[SNTP_PACKET_SIZE];
+    sntpBuildRequest(packet, transmitTimestamp);
+
+    Kernel::Clock::time_point sentAt = Kernel::Clock::now();
+    nsapi_size_or_error_t sent = socket.sendto(address, packet, sizeof(packet));
+    if (sent < 0) {
+        socket.close();
+        return sent;
+    }
+    timing->bytesSent = sent;
+
+    // Reads until the answer to this request arrives. Late answers to earlier requests are ignored
+    while (true) {
+        SocketAddress from;
+        nsapi_size_or_error_t received = socket.recvfrom(&from, packet, sizeof(packet));
+        if (received < 0) {
+            socket.close();
+            return received == NSAPI_ERROR_WOULD_BLOCK ? NSAPI_ERROR_TIMEOUT : received;
+        }
+
+        *receivedAt = Kernel::Clock::now();
+        int64_t roundTripUs = duration_cast<microseconds>(*receivedAt - sentAt).count();
+        timing->bytesReceived += received;
+
+        if (sntpParseResponse(packet, received, transmitTimestamp, roundTripUs, time)) {
+            timing->ms[TimingFirstByte] = roundTripUs / 1000;
+            socket.close();
+            return NSAPI_ERROR_OK;
+        }
+
+        if (*receivedAt - sentAt >= milliseconds(MBED_CONF_APP_SNTP_TIMEOUT)) {
+            socket.close();
+            return NSAPI_ERROR_TIMEOUT;
+        }
+    }
+}
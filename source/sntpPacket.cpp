@@ -0,0 +1,86 @@
+/**
+ * @file   sntpPacket.cpp
+ * @author Tobias Kallevik
+*/
+
+#include "sntpPacket.h"
+#include <cstring>
+
+// Seconds from the NTP epoch (1900) to the unix epoch (1970)
+#define NTP_UNIX_OFFSET 2208988800ULL
+
+// Field offsets in the packet
+#define SNTP_STRATUM 1
+#define SNTP_RECEIVE 32
+#define SNTP_ORIGINATE 24
+#define SNTP_TRANSMIT 40
+
+static uint64_t readTimestamp(const uint8_t *data) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+static void writeTimestamp(uint8_t *data, uint64_t value) {
+    for (int i = 7; i >= 0; i--) {
+        data[i] = value & 0xFF;
+        value >>= 8;
+    }
+}
+
+// Converts a 32.32 fixed point NTP timestamp to microseconds since the unix epoch. Timestamps with
+// the top bit clear are taken to be after the NTP era rolls over in 2036
+static int64_t toUnixUs(uint64_t timestamp) {
+    uint64_t seconds = timestamp >> 32;
+    uint64_t fraction = timestamp & 0xFFFFFFFFULL;
+    if ((seconds & 0x80000000ULL) == 0) {
+        seconds += 0x100000000ULL;
+    }
+    return (int64_t)(seconds - NTP_UNIX_OFFSET) * 1000000 + (int64_t)((fraction * 1000000) >> 32);
+}
+
+void sntpBuildRequest(uint8_t packet[SNTP_PACKET_SIZE], uint64_t transmitTimestamp) {
+    memset(packet, 0, SNTP_PACKET_SIZE);
+    // Leap indicator 0, version 4, mode 3 (client)
+    packet[0] = (0 << 6) | (4 << 3) | 3;
+    writeTimestamp(packet + SNTP_TRANSMIT, transmitTimestamp);
+}
+
+bool sntpParseResponse(const uint8_t *packet, size_t length, uint64_t transmitTimestamp, int64_t roundTripUs, SntpTime *time) {
+    if (length < SNTP_PACKET_SIZE) {
+        return false;
+    }
+
+    // Must be a server answer (mode 4) to this request. Leap indicator 3 means the server clock isn't
+    // synchronized, and stratum 0 is a "kiss of death" telling the client to back off
+    int leap = packet[0] >> 6;
+    int mode = packet[0] & 0x07;
+    int stratum = packet[SNTP_STRATUM];
+    if (mode != 4 || leap == 3 || stratum == 0 || stratum > 15) {
+        return false;
+    }
+    if (readTimestamp(packet + SNTP_ORIGINATE) != transmitTimestamp) {
+        return false;
+    }
+
+    uint64_t receive = readTimestamp(packet + SNTP_RECEIVE);
+    uint64_t transmit = readTimestamp(packet + SNTP_TRANSMIT);
+    if (transmit == 0) {
+        return false;
+    }
+
+    // The network delay is the local round trip minus the time the server held the request
+    int64_t serverUs = toUnixUs(transmit) - toUnixUs(receive);
+    int64_t delayUs = roundTripUs - serverUs;
+    if (delayUs < 0) {
+        delayUs = 0;
+    }
+
+    // The response took about half the delay to arrive
+    time->unixTimeUs = toUnixUs(transmit) + delayUs / 2;
+    time->delayUs = delayUs;
+    time->stratum = stratum;
+    return true;
+}
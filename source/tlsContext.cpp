@@ -0,0 +1,191 @@
+/**
+ * @file   tlsContext.cpp
+ * @author Tobias Kallevik
+*/
+
+#include "tlsContext.h"
+#include <cstdio>
+#include <cstring>
+
+TlsContext::TlsContext() {
+    mbedtls_entropy_init(&_entropy);
+    mbedtls_ctr_drbg_init(&_ctrDrbg);
+    mbedtls_x509_crt_init(&_caChain);
+    mbedtls_ssl_config_init(&_config);
+    mbedtls_ssl_session_init(&_session);
+}
+
+TlsContext::~TlsContext() {
+    mbedtls_ssl_session_free(&_session);
+    mbedtls_ssl_config_free(&_config);
+    mbedtls_x509_crt_free(&_caChain);
+    mbedtls_ctr_drbg_free(&_ctrDrbg);
+    mbedtls_entropy_free(&_entropy);
+}
+
+// Parses the certificate and builds the client configuration used by every later handshake
+nsapi_error_t TlsContext::init(const char *caCert) {
+    const char personalization[] = "smartwatch tls";
+    int result;
+
+    _mutex.lock();
+
+    if (_ready) {
+        _mutex.unlock();
+        return NSAPI_ERROR_OK;
+    }
+
+    // Seeds the random generator
+    result = mbedtls_ctr_drbg_seed(&_ctrDrbg, mbedtls_entropy_func, &_entropy,
+                                   (const unsigned char *)personalization, sizeof(personalization));
+    if (result != 0) {
+        printf("\nFailed to seed TLS random generator: -0x%04x", -result);
+        _mutex.unlock();
+        return NSAPI_ERROR_DEVICE_ERROR;
+    }
+
+    // Parses the PEM certificate. The length has to include the terminating null
+    result = mbedtls_x509_crt_parse(&_caChain, (const unsigned char *)caCert, strlen(caCert) + 1);
+    if (result != 0) {
+        printf("\nFailed to parse CA certificate: -0x%04x", -result);
+        _mutex.unlock();
+        return NSAPI_ERROR_PARAMETER;
+    }
+
+    // Sets up a client configuration that requires the server to be verified against the CA
+    result = mbedtls_ssl_config_defaults(&_config, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+    if (result != 0) {
+        printf("\nFailed to set up TLS config: -0x%04x", -result);
+        _mutex.unlock();
+        return NSAPI_ERROR_DEVICE_ERROR;
+    }
+    mbedtls_ssl_conf_authmode(&_config, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_ca_chain(&_config, &_caChain, NULL);
+    mbedtls_ssl_conf_rng(&_config, mbedtls_ctr_drbg_random, &_ctrDrbg);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    // Lets the server resume the session from a ticket instead of its own session cache
+    mbedtls_ssl_conf_session_tickets(&_config, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+
+    _ready = true;
+    _mutex.unlock();
+    return NSAPI_ERROR_OK;
+}
+
+void TlsContext::restoreSession(mbedtls_ssl_context *ssl) {
+    _mutex.lock();
+    if (_hasSession) {
+        mbedtls_ssl_set_session(ssl, &_session);
+    }
+    _mutex.unlock();
+}
+
+void TlsContext::saveSession(const mbedtls_ssl_context *ssl) {
+    _mutex.lock();
+    mbedtls_ssl_session_free(&_session);
+    mbedtls_ssl_session_init(&_session);
+    _hasSession = mbedtls_ssl_get_session(ssl, &_session) == 0;
+    _mutex.unlock();
+}
+
+void TlsContext::clearSession() {
+    _mutex.lock();
+    mbedtls_ssl_session_free(&_session);
+    mbedtls_ssl_session_init(&_session);
+    _hasSession = false;
+    _mutex.unlock();
+}
+
+TlsStream::TlsStream(TlsContext *context, TCPSocket *socket) : _context(context), _socket(socket) {
+    mbedtls_ssl_init(&_ssl);
+}
+
+TlsStream::~TlsStream() {
+    close();
+    mbedtls_ssl_free(&_ssl);
+}
+
+// Runs the handshake. The saved session is set between the setup and the first message, which
+// TLSSocket gives no access to, so mbed TLS is driven directly here
+nsapi_error_t TlsStream::handshake(const char *host) {
+    int result = mbedtls_ssl_setup(&_ssl, _context->config());
+    if (result != 0) {
+        printf("\nFailed to set up TLS: -0x%04x", -result);
+        return NSAPI_ERROR_NO_MEMORY;
+    }
+
+    mbedtls_ssl_set_hostname(&_ssl, host);
+    mbedtls_ssl_set_bio(&_ssl, this, bioSend, bioRecv, NULL);
+    _context->restoreSession(&_ssl);
+
+    // Runs the handshake until done. Socket timeouts are reported as errors by bioSend and bioRecv, so this can't loop forever
+    do {
+        result = mbedtls_ssl_handshake(&_ssl);
+    } while (result == MBEDTLS_ERR_SSL_WANT_READ || result == MBEDTLS_ERR_SSL_WANT_WRITE);
+
+    if (result != 0) {
+        printf("\nTLS handshake with %s failed: -0x%04x", host, -result);
+        // A broken session would make every later handshake fail the same way
+        _context->clearSession();
+        return NSAPI_ERROR_AUTH_FAILURE;
+    }
+
+    _context->saveSession(&_ssl);
+    _connected = true;
+    return NSAPI_ERROR_OK;
+}
+
+// A send timeout is an error from bioSend, so only a write mbed TLS cut short itself is retried
+nsapi_size_or_error_t TlsStream::send(const void *data, nsapi_size_t length) {
+    int result;
+
+    do {
+        result = mbedtls_ssl_write(&_ssl, (const unsigned char *)data, length);
+    } while (result == MBEDTLS_ERR_SSL_WANT_WRITE);
+
+    return result < 0 ? NSAPI_ERROR_CONNECTION_LOST : result;
+}
+
+// Reads decrypted data. Returns 0 when the server has closed the connection, like a socket
+nsapi_size_or_error_t TlsStream::recv(void *data, nsapi_size_t length) {
+    int result = mbedtls_ssl_read(&_ssl, (unsigned char *)data, length);
+
+    if (result == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY || result == MBEDTLS_ERR_SSL_CONN_EOF) {
+        return 0;
+    }
+    if (result == MBEDTLS_ERR_SSL_TIMEOUT || result == MBEDTLS_ERR_SSL_WANT_READ) {
+        return NSAPI_ERROR_WOULD_BLOCK;
+    }
+
+    return result < 0 ? NSAPI_ERROR_CONNECTION_LOST : result;
+}
+
+void TlsStream::close() {
+    if (_connected) {
+        mbedtls_ssl_close_notify(&_ssl);
+        _connected = false;
+    }
+}
+
+// Passes encrypted data from mbed TLS to the socket. A socket timeout ends the write, since a link that
+// has stopped taking data would otherwise be retried forever
+int TlsStream::bioSend(void *context, const unsigned char *data, size_t length) {
+    TlsStream *stream = static_cast<TlsStream *>(context);
+    nsapi_size_or_error_t result = stream->_socket->send(data, length);
+
+    if (result == NSAPI_ERROR_WOULD_BLOCK) {
+        return MBEDTLS_ERR_SSL_TIMEOUT;
+    }
+    return result;
+}
+
+// Passes encrypted data from the socket to mbed TLS. A socket timeout ends the read
+int TlsStream::bioRecv(void *context, unsigned char *data, size_t length) {
+    TlsStream *stream = static_cast<TlsStream *>(context);
+    nsapi_size_or_error_t result = stream->_socket->recv(data, length);
+
+    if (result == NSAPI_ERROR_WOULD_BLOCK) {
+        return MBEDTLS_ERR_SSL_TIMEOUT;
+    }
+    return result;
+}
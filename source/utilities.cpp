@@ -7,41 +7,39 @@
 #include "screens.h"
 #include "utilities.h"
 #include <cstdio>
+#include <cstdlib>
 
 // Function used to connect the device to the network
 void connectToNetwork(SharedData *sharedData) {
 
-    nsapi_size_or_error_t result;
     // Locks the mutex to protect the shared data
     sharedData->mutex.lock();
     // Gets the default network interface
     sharedData->network = NetworkInterface::get_default_instance();
+    NetworkInterface *network = sharedData->network;
+    // Unlcoks the mutex. It isn't held while connecting, which can take a long time
+    sharedData->mutex.unlock();
+
     // Check if inteface was obtaind 
-    if (!sharedData->network) {
+    if (!network) {
         printf("Failed to get default network interface\n");
+        return;
     }
-
-    // Connect to the network
-    do {
-        printf("\nConnecting to the network");
-        result = sharedData->network->connect();
-
-        if (result != NSAPI_ERROR_OK) {
-            printf("\nFailed to connect to network: %d", result);
-        }
-        
-    } while (result != NSAPI_ERROR_OK);
-
-    // Unlcoks the mutex
-    sharedData->mutex.unlock();
-
-    // Check if connection was successfull
-    if (result != 0) {
-        printf("\nFailed to connect to network: %d", result);
-
-    } else {
-        printf("\nConnected to network!");
+    sharedData->dns.setNetwork(network);
+    sharedData->http.setNetwork(network, &sharedData->dns);
+    sharedData->sntp.setNetwork(network, &sharedData->dns);
+
+    // Connects, and keeps the link up from here on
+    sharedData->networkManager.init(network);
+    sharedData->networkManager.connect();
+
+    // Seeds the random numbers used for backoff jitter. The MAC address differs between devices and the connect time varies
+    uint32_t seed = Kernel::get_ms_count();
+    const char *mac = network->get_mac_address();
+    for (; mac != nullptr && *mac != 0; mac++) {
+        seed = seed * 31 + *mac;
     }
+    srand(seed);
 }
 
 // Function used by the systemTimeThread to get system time as up to data variables
@@ -54,7 +52,12 @@ void systemTimeThreadFunc(void *arg) {
         systemTimeData->mutex.lock();
 
         // Get the current time as epoch time, convert the time to lt annd finds the amount of second that has passed this day
+        // The drift the RTC has built up since the last sync is added, rounded to whole seconds
         systemTimeData->currentEpochTime = time(NULL);
+        if (systemTimeData->clockDiscipline != nullptr) {
+            int64_t correctionUs = systemTimeData->clockDiscipline->correctionUs();
+            systemTimeData->currentEpochTime += (correctionUs + (correctionUs < 0 ? -500000 : 500000)) / 1000000;
+        }
         tm *ltm = localtime(&systemTimeData->currentEpochTime);
         systemTimeData->clockInSec = (ltm->tm_hour * 3600) + (ltm-> tm_min*60) + ltm->tm_sec;
 
@@ -154,52 +157,13 @@ void alarmCheck(AlarmData *alarmData, SystemTimeData *systemTimeData, PwmOut *bu
     alarmData->ringingAlarmSeconds = duration_cast<seconds>(alarmData->alarmRingingTimer.elapsed_time()).count();
 }
 
-// Checks if it has been longer than 15 min since last time time was fetched
-void timeApiCheck(SharedData *sharedData, DFRobot_RGBLCD *lcd) {
-    
-    // Fetches the time data if it has been more than 15 min since last fetch. This is done by setting the thread flag and unblocking the weather API thread
-    if (sharedData->lastTimeApiRunTime + 900 <= time(NULL)) { 
-        sharedData->timeThreadFlag.set(timeFlagBtn); 
-        lcd->clear();
-    }
+// Lets the refresh scheduler queue the sources that are due. The source shown on the screen gets a tighter budget
+// The display is cleared when the shown source is queued, so it is redrawn when the new data arrives
+void refreshCheck(SharedData *sharedData, FetchJob visible, LcdCanvas *lcd) {
 
-}
+    sharedData->refresh.setVisible(visible);
 
-// Checks if it has been longer than 15 min since last time weather was fetched
-void weatherApiCheck(SharedData *sharedData, DFRobot_RGBLCD *lcd) {
-    
-    // Fetches the weather data if it has been more than 15 min since last fetch. This is done by setting the thread flag and unblocking the weather API thread
-    if (sharedData->lastWeatherApiRunTime + 900 <= time(NULL)) { 
-        sharedData->weatherThreadFlag.set(weatherFlagBtn);
-        lcd->clear(); 
+    if (sharedData->refresh.poll(&sharedData->fetchQueue, sharedData->fetchHealth)) {
+        lcd->clear();
     }
-
 }
-
-// Scrolls the feed from right to left for a given char
-void scrollFeed(bool *menuSwitched, string rssFeed, AlarmData *alarmData, SystemTimeData *systemTimeData, PwmOut *buzzer, DFRobot_RGBLCD *lcd) {
-
-    // Creates a new char containing the RSS feed
-    char rssChar[rssFeed.size()];
-    strcpy(rssChar, rssFeed.c_str());
-
-    // Prints each letter in the rss feed while moving the previous letters to the left
-    for (int i = 0; i < sizeof(rssChar)-16; i++) {
-        
-        // Breaks the loop if the user changes screens/menus
-        if (*menuSwitched == true) {return;} 
-
-        lcd->setCursor(0, 1);
-
-        // Prints 16 characters of the rss feed at a time
-        for (int j = i; j < i + 16; j++) {
-            lcd->printf("%c", rssChar[j]);
-        }
-
-        // Runs the alarm chack to avoid missing an alarm while inside the for loop
-        alarmCheck(alarmData, systemTimeData, buzzer);
-
-        thread_sleep_for(250);
-        lcd->printf("                ");
-    } 
-}
\ No newline at end of file